@@ -0,0 +1,338 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+// Microbenchmark of the buffering strategies.
+//
+// Each run lexes the same generated input (space separated tokens)
+// block by block into one sink. The grid covers the block size,
+// the token length distribution, the fraction of tokens that span
+// blocks and the sink type. The naive sink appends char by char
+// to a string, i.e. without any buffer. The *_moved sinks move each
+// finished token out of the buffer (as a consumer that keeps tokens
+// would), i.e. every token starts in a moved-from buffer. Besides
+// the time, the allocations during a run are reported. The file sinks
+// write with the page cache, with O_DIRECT (file_direct) and with
+// preallocation and incremental writeback (file_writeback).
+//
+// Results are written as CSV (default) or JSON to stdout, e.g.:
+//
+//     $ ./bench --size 64 --format json > bench.json
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+#include <buffer/small_vector.h>
+#include "common.h"
+
+#include <boost/filesystem.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+using namespace Bench;
+
+namespace {
+
+  struct Options {
+    size_t size {16 * 1024 * 1024};
+    unsigned repeat {3};
+    bool json {false};
+    string dir {"tmp"};
+    vector<size_t> blocks { 4 * 1024, 64 * 1024, 1024 * 1024 };
+    vector<string> dists { "fixed8", "fixed64", "uniform", "pareto" };
+    vector<double> spans { 0, 0.01, 0.1 };
+    vector<string> sinks { "naive", "vector", "small_vector", "vector_moved",
+      "small_vector_moved", "proxy", "file", "file_direct", "file_writeback",
+      "null" };
+  };
+
+  struct Input {
+    string data;
+    // [begin, end) offsets of the blocks
+    vector<pair<size_t, size_t> > blocks;
+    size_t tokens {0};
+    size_t spanning {0};
+  };
+
+  size_t token_length(const string &dist, mt19937 &g)
+  {
+    if (dist == "fixed8")
+      return 8;
+    if (dist == "fixed64")
+      return 64;
+    if (dist == "uniform")
+      return uniform_int_distribution<size_t>(1, 256)(g);
+    if (dist == "pareto") {
+      // mostly short, some long tokens
+      double u = uniform_real_distribution<double>(0.0001, 1)(g);
+      return min(size_t(4 / pow(u, 1 / 1.2)), size_t(64 * 1024));
+    }
+    throw runtime_error("unknown distribution: " + dist);
+  }
+
+  // Blocks end at token boundaries when they reach the block size;
+  // additionally, each token is split in its middle with
+  // probability span.
+  Input generate(size_t size, const string &dist, size_t block, double span)
+  {
+    Input r;
+    mt19937 g(23);
+    bernoulli_distribution split(span);
+    r.data.reserve(size + 64 * 1024);
+    size_t begin = 0;
+    while (r.data.size() < size) {
+      size_t n = token_length(dist, g);
+      size_t off = r.data.size();
+      for (size_t i = 0; i < n; ++i)
+        r.data += char('a' + (off + i) % 26);
+      ++r.tokens;
+      if (n > 1 && split(g)) {
+        r.blocks.emplace_back(begin, off + n / 2);
+        begin = off + n / 2;
+        ++r.spanning;
+      }
+      r.data += ' ';
+      if (r.data.size() - begin >= block) {
+        r.blocks.emplace_back(begin, r.data.size());
+        begin = r.data.size();
+      }
+    }
+    if (begin != r.data.size())
+      r.blocks.emplace_back(begin, r.data.size());
+    return r;
+  }
+
+  // accumulated such that the sinks aren't optimized away
+  size_t check_sum = 0;
+
+  template <typename F> void lex(const Input &in, Memory::Buffer::Base &b,
+      F consume)
+  {
+    using namespace Memory;
+    bool in_token = false;
+    for (auto &blk : in.blocks) {
+      const char *p = in.data.data() + blk.first;
+      const char *pe = in.data.data() + blk.second;
+      Buffer::Resume r(b, p, pe);
+      for (; p != pe; ++p) {
+        if (*p == ' ') {
+          if (in_token) {
+            b.finish(p);
+            consume();
+            in_token = false;
+          }
+        } else if (!in_token) {
+          b.start(p);
+          in_token = true;
+        }
+      }
+    }
+  }
+
+  void lex_naive(const Input &in)
+  {
+    string s;
+    for (auto &blk : in.blocks) {
+      const char *p = in.data.data() + blk.first;
+      const char *pe = in.data.data() + blk.second;
+      for (; p != pe; ++p) {
+        if (*p == ' ') {
+          if (!s.empty()) {
+            check_sum += s.size();
+            s.clear();
+          }
+        } else {
+          s.push_back(*p);
+        }
+      }
+    }
+  }
+
+  void run(const Options &o, const Input &in, const string &sink)
+  {
+    using namespace Memory;
+    if (sink == "naive") {
+      lex_naive(in);
+    } else if (sink == "vector") {
+      Buffer::Vector v;
+      lex(in, v, [&v]() { check_sum += v.size(); });
+    } else if (sink == "small_vector") {
+      Buffer::Small_Vector<64> v;
+      lex(in, v, [&v]() { check_sum += v.size(); });
+    } else if (sink == "vector_moved") {
+      Buffer::Vector v;
+      lex(in, v, [&v]() {
+          Buffer::Vector w(std::move(v));
+          w.commit();
+          check_sum += w.size(); });
+    } else if (sink == "small_vector_moved") {
+      Buffer::Small_Vector<64> v;
+      lex(in, v, [&v]() {
+          Buffer::Small_Vector<64> w(std::move(v));
+          w.commit();
+          check_sum += w.size(); });
+    } else if (sink == "proxy") {
+      Buffer::Vector v;
+      Buffer::Proxy p(&v);
+      lex(in, p, [&v]() { check_sum += v.size(); });
+    } else if (sink == "file" || sink == "file_direct"
+        || sink == "file_writeback") {
+      boost::filesystem::remove(o.dir + "/bench.out");
+      Buffer::File f(o.dir, "bench.out", true,
+          sink == "file_direct" ? Buffer::File::DIRECT : 0);
+      f.set_sync(false);
+      if (sink == "file_writeback") {
+        f.preallocate(in.data.size());
+        f.set_writeback(1024 * 1024);
+      }
+      lex(in, f, []() {});
+      f.close();
+    } else if (sink == "null") {
+      Buffer::Null n;
+      lex(in, n, []() {});
+    } else {
+      throw runtime_error("unknown sink: " + sink);
+    }
+  }
+
+  void help(const char *argv0)
+  {
+    cerr << "call: " << argv0 << " [OPTION]...\n"
+      "  --size MIB        input size (default: 16)\n"
+      "  --repeat N        best of N runs (default: 3)\n"
+      "  --format csv|json\n"
+      "  --dir DIR         directory for the file sink (default: tmp)\n"
+      "  --blocks B1,B2..  block sizes in bytes\n"
+      "  --dists D1,D2..   token length distributions:"
+      " fixed8, fixed64, uniform, pareto\n"
+      "  --spans F1,F2..   fraction of tokens that span blocks\n"
+      "  --sinks S1,S2..   naive, vector, small_vector, vector_moved,\n"
+      "                    small_vector_moved, proxy, file, file_direct,\n"
+      "                    file_writeback, null\n";
+  }
+
+  Options parse(int argc, char **argv)
+  {
+    Options o;
+    for (int i = 1; i < argc; ++i) {
+      string a(argv[i]);
+      if (a == "-h" || a == "--help") {
+        help(argv[0]);
+        exit(0);
+      }
+      if (i + 1 == argc)
+        throw runtime_error("missing argument of " + a);
+      const char *v = argv[++i];
+      if (a == "--size")
+        o.size = size_t(atof(v) * 1024 * 1024);
+      else if (a == "--repeat")
+        o.repeat = max(atoi(v), 1);
+      else if (a == "--format")
+        o.json = !strcmp(v, "json");
+      else if (a == "--dir")
+        o.dir = v;
+      else if (a == "--blocks")
+        o.blocks = parse_list<size_t>(v);
+      else if (a == "--dists")
+        o.dists = parse_list<string>(v);
+      else if (a == "--spans")
+        o.spans = parse_list<double>(v);
+      else if (a == "--sinks")
+        o.sinks = parse_list<string>(v);
+      else
+        throw runtime_error("unknown option: " + a);
+    }
+    return o;
+  }
+
+}
+
+int main(int argc, char **argv)
+{
+  try {
+    Options o = parse(argc, argv);
+    boost::filesystem::create_directories(o.dir);
+    if (o.json)
+      cout << "[\n";
+    else
+      cout << "sink,block,dist,span,bytes,tokens,spanning,blocks,"
+        "seconds,mib_per_s,ns_per_token,allocations,allocated_bytes\n";
+    bool first = true;
+    for (auto block : o.blocks)
+      for (auto &dist : o.dists)
+        for (auto span : o.spans) {
+          Input in(generate(o.size, dist, block, span));
+          for (auto &sink : o.sinks) {
+            double best = 0;
+            size_t allocs = 0, bytes = 0;
+            for (unsigned i = 0; i < o.repeat; ++i) {
+              size_t a = allocations, ab = allocated_bytes;
+              auto t = chrono::steady_clock::now();
+              run(o, in, sink);
+              double s = chrono::duration<double>(
+                  chrono::steady_clock::now() - t).count();
+              allocs = allocations - a;
+              bytes = allocated_bytes - ab;
+              if (!i || s < best)
+                best = s;
+            }
+            double mib = in.data.size() / best / 1024 / 1024;
+            double ns = best * 1e9 / in.tokens;
+            if (o.json) {
+              cout << (first ? "" : ",\n")
+                << "  {\"sink\": \"" << sink << "\", \"block\": " << block
+                << ", \"dist\": \"" << dist << "\", \"span\": " << span
+                << ", \"bytes\": " << in.data.size()
+                << ", \"tokens\": " << in.tokens
+                << ", \"spanning\": " << in.spanning
+                << ", \"blocks\": " << in.blocks.size()
+                << ", \"seconds\": " << best
+                << ", \"mib_per_s\": " << mib
+                << ", \"ns_per_token\": " << ns
+                << ", \"allocations\": " << allocs
+                << ", \"allocated_bytes\": " << bytes << "}";
+            } else {
+              cout << sink << ',' << block << ',' << dist << ',' << span
+                << ',' << in.data.size() << ',' << in.tokens << ','
+                << in.spanning << ',' << in.blocks.size() << ',' << best
+                << ',' << mib << ',' << ns << ',' << allocs << ','
+                << bytes << '\n';
+            }
+            first = false;
+          }
+        }
+    if (o.json)
+      cout << "\n]\n";
+    cerr << "check sum: " << check_sum << '\n';
+  } catch (const exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
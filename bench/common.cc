@@ -0,0 +1,63 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "common.h"
+
+#include <stdlib.h>
+#include <new>
+using namespace std;
+
+namespace Bench {
+
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+
+  template <> vector<string> parse_list<string>(const char *s)
+  {
+    vector<string> r;
+    string x(s);
+    size_t i = 0;
+    for (;;) {
+      size_t k = x.find(',', i);
+      r.push_back(x.substr(i, k == string::npos ? string::npos : k - i));
+      if (k == string::npos)
+        break;
+      i = k + 1;
+    }
+    return r;
+  }
+
+}
+
+// counts the allocations during a run - not inlined such that
+// they are always paired with free()
+__attribute__((noinline)) void *operator new(size_t n)
+{
+  ++Bench::allocations;
+  Bench::allocated_bytes += n;
+  void *p = malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+  free(p);
+}
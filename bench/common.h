@@ -0,0 +1,58 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BENCH_COMMON_H
+#define GMS_BENCH_COMMON_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Shared by the bench and trace tools.
+namespace Bench {
+
+  // incremented by the global operator new (cf. common.cc)
+  extern size_t allocations;
+  extern size_t allocated_bytes;
+
+  // splits a comma separated list, an empty element is T()
+  template <typename T> std::vector<T> parse_list(const char *s)
+  {
+    std::vector<T> r;
+    std::string x(s);
+    size_t i = 0;
+    for (;;) {
+      size_t k = x.find(',', i);
+      std::string e(x.substr(i, k == std::string::npos ? std::string::npos
+            : k - i));
+      r.push_back(T());
+      if (!e.empty())
+        r.back() = T(std::stod(e));
+      if (k == std::string::npos)
+        break;
+      i = k + 1;
+    }
+    return r;
+  }
+  template <> std::vector<std::string> parse_list<std::string>(const char *s);
+
+}
+
+#endif
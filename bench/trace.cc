@@ -0,0 +1,255 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+
+// Records the shape of a lexer run (read sizes, token boundaries)
+// and replays it against different sinks.
+//
+//     $ nc host port | ./trace record conn.trace
+//     $ ./trace replay conn.trace --sinks vector,file --format json
+//
+// record reads stdin with the read sizes as they come (e.g. short
+// reads from a socket or pipe) and splits tokens at a delimiter
+// (default: newline) - a trace can also be recorded from a real
+// lexer via Buffer::Recorder.
+//
+// replay reports ns/token, the allocations during the replay
+// and the bytes the sink was handed via buffer_copy() (including
+// the ranges a sink references without copying).
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+#include <buffer/small_vector.h>
+#include <buffer/spill.h>
+#include <buffer/trace.h>
+#include "common.h"
+
+#include <boost/filesystem.hpp>
+
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+using namespace Bench;
+
+namespace {
+
+  void help(const char *argv0)
+  {
+    cerr << "call: " << argv0 << " record TRACE [--delim CHAR]"
+      " [--block BYTES]\n"
+      "       " << argv0 << " replay TRACE [--sinks S1,S2..]"
+      " [--repeat N] [--format csv|json] [--dir DIR]\n"
+      "sinks: vector, small_vector, proxy, file, null, spill\n";
+  }
+
+  void record(const string &filename, char delim, size_t block)
+  {
+    using namespace Memory;
+    Trace t;
+    Buffer::Recorder r(t);
+    vector<char> b(block);
+    bool in = false;
+    for (;;) {
+      ssize_t n = ::read(0, b.data(), b.size());
+      if (n == -1) {
+        if (errno == EINTR)
+          continue;
+        throw runtime_error(string("read: ") + strerror(errno));
+      }
+      if (!n)
+        break;
+      const char *p = b.data();
+      const char *pe = p + n;
+      Buffer::Resume res(r, p, pe);
+      for (; p != pe; ++p) {
+        if (*p == delim) {
+          if (in)
+            r.finish(p);
+          in = false;
+        } else if (!in) {
+          r.start(p);
+          in = true;
+        }
+      }
+    }
+    if (in)
+      r.finish();
+    t.save(filename);
+    cerr << "events: " << t.events() << ", tokens: " << t.tokens()
+      << ", blocks: " << t.blocks() << ", bytes: " << t.size() << '\n';
+  }
+
+  // sums the bytes passed to the buffer_copy() of a sink - as
+  // sub-class, since the Caller methods call it virtually
+  template <typename T> class Counting : public T {
+    private:
+      size_t &copied_;
+    public:
+      template <typename... As> Counting(size_t &copied, As&&... as)
+        : T(std::forward<As>(as)...), copied_(copied)
+      {
+      }
+      void buffer_copy(const char *begin, const char *end, bool last)
+        override
+      {
+        copied_ += end - begin;
+        T::buffer_copy(begin, end, last);
+      }
+  };
+
+  unique_ptr<Memory::Buffer::Base> make_sink(const string &name,
+      const string &dir, unique_ptr<Memory::Buffer::Base> &target,
+      size_t &copied)
+  {
+    using namespace Memory;
+    if (name == "vector")
+      return unique_ptr<Buffer::Base>(new Counting<Buffer::Vector>(copied));
+    if (name == "small_vector")
+      return unique_ptr<Buffer::Base>(
+          new Counting<Buffer::Small_Vector<64> >(copied));
+    if (name == "proxy") {
+      target.reset(new Counting<Buffer::Vector>(copied));
+      return unique_ptr<Buffer::Base>(new Buffer::Proxy(target.get()));
+    }
+    if (name == "file") {
+      boost::filesystem::remove(dir + "/trace.out");
+      Buffer::File *f = new Counting<Buffer::File>(copied, dir,
+          "trace.out");
+      f->set_sync(false);
+      return unique_ptr<Buffer::Base>(f);
+    }
+    if (name == "null")
+      return unique_ptr<Buffer::Base>(new Buffer::Null);
+    if (name == "spill")
+      return unique_ptr<Buffer::Base>(new Counting<Buffer::Spill>(copied));
+    throw runtime_error("unknown sink: " + name);
+  }
+
+  void replay(const string &filename, const vector<string> &sinks,
+      unsigned repeat, bool json, const string &dir)
+  {
+    using namespace Memory;
+    Trace t;
+    t.load(filename);
+    Replay r(t);
+    boost::filesystem::create_directories(dir);
+    if (json)
+      cout << "[\n";
+    else
+      cout << "sink,tokens,blocks,seconds,ns_per_token,allocations,"
+        "allocated_bytes,bytes_copied\n";
+    bool first = true;
+    for (auto &name : sinks) {
+      double best = 0;
+      size_t allocs = 0, bytes = 0, copied = 0;
+      for (unsigned i = 0; i < repeat; ++i) {
+        unique_ptr<Buffer::Base> target;
+        copied = 0;
+        unique_ptr<Buffer::Base> b(make_sink(name, dir, target, copied));
+        size_t a = allocations, ab = allocated_bytes;
+        auto start = chrono::steady_clock::now();
+        r.run(*b);
+        double s = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+        allocs = allocations - a;
+        bytes = allocated_bytes - ab;
+        if (!i || s < best)
+          best = s;
+      }
+      double ns = t.tokens() ? best * 1e9 / t.tokens() : 0;
+      if (json) {
+        cout << (first ? "" : ",\n")
+          << "  {\"sink\": \"" << name << "\", \"tokens\": " << t.tokens()
+          << ", \"blocks\": " << t.blocks() << ", \"seconds\": " << best
+          << ", \"ns_per_token\": " << ns
+          << ", \"allocations\": " << allocs
+          << ", \"allocated_bytes\": " << bytes
+          << ", \"bytes_copied\": " << copied << "}";
+      } else {
+        cout << name << ',' << t.tokens() << ',' << t.blocks() << ','
+          << best << ',' << ns << ',' << allocs << ',' << bytes << ','
+          << copied << '\n';
+      }
+      first = false;
+    }
+    if (json)
+      cout << "\n]\n";
+  }
+
+}
+
+int main(int argc, char **argv)
+{
+  try {
+    if (argc < 3 || strcmp(argv[1], "-h") == 0) {
+      help(argv[0]);
+      return argc < 3;
+    }
+    string cmd(argv[1]);
+    string filename(argv[2]);
+    char delim = '\n';
+    size_t block = 64 * 1024;
+    vector<string> sinks { "vector", "small_vector", "proxy", "file",
+      "null", "spill" };
+    unsigned repeat = 3;
+    bool json = false;
+    string dir("tmp");
+    for (int i = 3; i < argc; ++i) {
+      string a(argv[i]);
+      if (i + 1 == argc)
+        throw runtime_error("missing argument of " + a);
+      string v(argv[++i]);
+      if (a == "--delim") {
+        delim = v == "\\n" ? '\n' : v.at(0);
+      } else if (a == "--block") {
+        block = max(atol(v.c_str()), 1l);
+      } else if (a == "--sinks") {
+        sinks = parse_list<string>(v.c_str());
+      } else if (a == "--repeat") {
+        repeat = max(atoi(v.c_str()), 1);
+      } else if (a == "--format") {
+        json = v == "json";
+      } else if (a == "--dir") {
+        dir = v;
+      } else {
+        throw runtime_error("unknown option: " + a);
+      }
+    }
+    if (cmd == "record")
+      record(filename, delim, block);
+    else if (cmd == "replay")
+      replay(filename, sinks, repeat, json, dir);
+    else
+      throw runtime_error("unknown command: " + cmd);
+  } catch (const exception &e) {
+    cerr << "error: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "batch.h"
+
+#include <cassert>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+  namespace Buffer {
+
+    Batch::Batch()
+    {
+    }
+    Batch::Batch(std::function<void(const Batch &)> consumer,
+        size_t max_tokens)
+      : max_tokens_(max_tokens), consumer_(std::move(consumer))
+    {
+    }
+    void Batch::set_consumer(std::function<void(const Batch &)> consumer)
+    {
+      consumer_ = std::move(consumer);
+    }
+    void Batch::set_max_tokens(size_t n)
+    {
+      max_tokens_ = n;
+    }
+
+    void Batch::start(const char *p)
+    {
+      Caller::start(p);
+      cur_off_ = arena_.size();
+      cur_copied_ = false;
+    }
+    void Batch::pause(const char *p)
+    {
+      Caller::pause(p);
+      // referenced tokens are only valid until the end of the block
+      flush();
+    }
+    void Batch::buffer_copy(const char *begin, const char *end, bool last)
+    {
+      assert(begin<=end);
+      if (begin != end) {
+        if (last && !cur_copied_) {
+          tokens_.push_back(Entry { begin, 0, size_t(end - begin) });
+          cur_off_ = arena_.size();
+          if (max_tokens_ && tokens_.size() >= max_tokens_)
+            flush();
+          return;
+        }
+        arena_.insert(arena_.end(), begin, end);
+        cur_copied_ = true;
+      }
+      if (!last)
+        return;
+      tokens_.push_back(Entry { nullptr, cur_off_, arena_.size() - cur_off_ });
+      cur_off_ = arena_.size();
+      cur_copied_ = false;
+      if (max_tokens_ && tokens_.size() >= max_tokens_)
+        flush();
+    }
+
+    void Batch::clear()
+    {
+      arena_.clear();
+      tokens_.clear();
+      cur_off_ = 0;
+      cur_copied_ = false;
+    }
+    void Batch::flush()
+    {
+      if (tokens_.empty())
+        return;
+      if (consumer_)
+        consumer_(*this);
+      tokens_.clear();
+      // keep the copied prefix of the active token
+      arena_.erase(arena_.begin(), arena_.begin() + cur_off_);
+      cur_off_ = 0;
+    }
+
+    size_t Batch::size() const
+    {
+      return tokens_.size();
+    }
+    bool Batch::empty() const
+    {
+      return tokens_.empty();
+    }
+    pair<const char*, const char*> Batch::operator[](size_t i) const
+    {
+      const Entry &e = tokens_[i];
+      const char *p = e.ref ? e.ref : arena_.data() + e.off;
+      return make_pair(p, p + e.len);
+    }
+
+  }
+}
@@ -0,0 +1,90 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_BATCH_H
+#define GMS_BUFFER_BATCH_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Collects many finished tokens, such that a consumer
+    // can process them at once.
+    //
+    // A token that is completely located in the current input block is
+    // recorded by reference (like Vector's range), a token that spans
+    // blocks is copied into one contiguous arena. The consumer is called
+    // at the end of each input block (i.e. on pause()), when
+    // max_tokens are collected and on flush(). Afterwards, the batch
+    // is emptied.
+    class Batch : public Caller {
+      private:
+        struct Entry {
+          // nullptr: located in the arena at off
+          const char *ref;
+          size_t off;
+          size_t len;
+        };
+        std::vector<char> arena_;
+        std::vector<Entry> tokens_;
+        // arena offset of the active token
+        size_t cur_off_ {0};
+        bool cur_copied_ {false};
+        size_t max_tokens_ {0};
+        std::function<void(const Batch &)> consumer_;
+      public:
+        Batch(const Batch &) =delete;
+        Batch &operator=(const Batch &) =delete;
+
+        Batch();
+        Batch(std::function<void(const Batch &)> consumer,
+            size_t max_tokens = 0);
+        // also called without max_tokens (0) set
+        void set_consumer(std::function<void(const Batch &)> consumer);
+        // deliver when that many tokens are collected, 0 means unlimited
+        void set_max_tokens(size_t n);
+
+        void start(const char *p) override;
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override;
+
+        void clear() override;
+        // calls the consumer (if there are tokens) and
+        // empties the batch
+        void flush();
+
+        size_t size() const;
+        bool empty() const;
+        std::pair<const char*, const char*> operator[](size_t i) const;
+    };
+
+  }
+}
+
+#endif
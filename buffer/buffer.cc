@@ -34,6 +34,10 @@ namespace Memory {
     Base::~Base()
     {
     }
+    const char *Base::pending() const
+    {
+      return nullptr;
+    }
 
     Resume::Resume(Base &b, const char *p, const char *&pe)
       :
@@ -48,59 +52,166 @@ namespace Memory {
       b.pause(pe);
     }
 
+    void Null::clear()
+    {
+    }
+    void Null::start(const char *)
+    {
+    }
+    void Null::cont(const char *)
+    {
+    }
+    void Null::stop(const char *)
+    {
+    }
+    void Null::finish(const char *)
+    {
+    }
+    void Null::finish()
+    {
+    }
+    void Null::resume(const char *)
+    {
+    }
+    void Null::pause(const char *)
+    {
+    }
+    void Null::buffer_copy(const char *, const char *, bool)
+    {
+    }
+
+    static Null null_buffer;
+
     Proxy::Proxy()
+      : b(&null_buffer)
+    {
+    }
+    Proxy::Proxy(Base *b)
+      : b(b ? b : &null_buffer)
     {
     }
     void Proxy::set(Base *b)
     {
-      this->b = b;
+      this->b = b ? b : &null_buffer;
     }
     void Proxy::clear()
     {
-      if (b)
-        b->clear();
+      b->clear();
     }
     void Proxy::start(const char *p)
     {
-      if (b)
-        b->start(p);
+      b->start(p);
     }
     void Proxy::cont(const char *p)
     {
-      if (b)
-        b->cont(p);
+      b->cont(p);
     }
     void Proxy::stop(const char *p)
     {
-      if (b)
-        b->stop(p);
+      b->stop(p);
     }
     void Proxy::finish(const char *p)
     {
-      if (b)
-        b->finish(p);
+      b->finish(p);
     }
     void Proxy::finish()
     {
-      if (b)
-        b->finish();
+      b->finish();
     }
     void Proxy::resume(const char *p)
     {
-      if (b)
-        b->resume(p);
+      b->resume(p);
     }
     void Proxy::pause(const char *p)
     {
-      if (b)
-        b->pause(p);
+      b->pause(p);
     }
     void Proxy::buffer_copy(const char *begin, const char *end,
             bool last)
     {
-      if (b)
+      b->buffer_copy(begin, end, last);
+    }
+    const char *Proxy::pending() const
+    {
+      return b->pending();
+    }
+
+    Tee::Tee()
+    {
+    }
+    Tee::Tee(std::initializer_list<Base*> l)
+    {
+      for (auto b : l)
+        add(b);
+    }
+    void Tee::add(Base *b)
+    {
+      if (!b)
+        throw logic_error("Tee: child is null");
+      v.push_back(b);
+    }
+    size_t Tee::size() const
+    {
+      return v.size();
+    }
+    void Tee::clear()
+    {
+      for (auto b : v)
+        b->clear();
+    }
+    void Tee::start(const char *p)
+    {
+      for (auto b : v)
+        b->start(p);
+    }
+    void Tee::cont(const char *p)
+    {
+      for (auto b : v)
+        b->cont(p);
+    }
+    void Tee::stop(const char *p)
+    {
+      for (auto b : v)
+        b->stop(p);
+    }
+    void Tee::finish(const char *p)
+    {
+      for (auto b : v)
+        b->finish(p);
+    }
+    void Tee::finish()
+    {
+      for (auto b : v)
+        b->finish();
+    }
+    void Tee::resume(const char *p)
+    {
+      for (auto b : v)
+        b->resume(p);
+    }
+    void Tee::pause(const char *p)
+    {
+      for (auto b : v)
+        b->pause(p);
+    }
+    void Tee::buffer_copy(const char *begin, const char *end,
+            bool last)
+    {
+      for (auto b : v)
         b->buffer_copy(begin, end, last);
     }
+    const char *Tee::pending() const
+    {
+      // a driver that relocates the pending part must not skip
+      // the pause() of a child that doesn't track it
+      if (v.empty())
+        return nullptr;
+      const char *r = v.front()->pending();
+      for (auto b : v)
+        if (b->pending() != r)
+          return nullptr;
+      return r;
+    }
 
     void Caller::clear()
     {
@@ -111,6 +222,9 @@ namespace Memory {
       assert(p);
       first = p;
       active_ = true;
+      GMS_BUFFER_STAT(len_ = 0);
+      GMS_BUFFER_STAT(blocks_ = 1);
+      GMS_BUFFER_PROBE1(start, p);
     }
     // two methods such that sub-classes
     // can something different
@@ -124,6 +238,7 @@ namespace Memory {
     {
       if (!first)
         return;
+      GMS_BUFFER_STAT(len_ += p - first);
       buffer_copy(first, p, false);
       first = nullptr;
       active_ = false;
@@ -132,32 +247,67 @@ namespace Memory {
     {
       if (!first)
         return;
+      GMS_BUFFER_STAT(len_ += p - first);
       buffer_copy(first, p, true);
       first = nullptr;
       active_ = false;
+      GMS_BUFFER_STAT(token_end());
+      GMS_BUFFER_PROBE1(finish, p);
     }
     void Caller::finish()
     {
-      if (!first)
+      // also after pause(), i.e. when first isn't set
+      if (!active_)
         return;
       buffer_copy(nullptr, nullptr, true);
       first = nullptr;
       active_ = false;
+      GMS_BUFFER_STAT(token_end());
+      GMS_BUFFER_PROBE1(finish, nullptr);
     }
     void Caller::resume(const char *p)
     {
       assert(p);
+      GMS_BUFFER_PROBE2(resume, p, active_);
       if (!active_)
         return;
       first = p;
     }
     void Caller::pause(const char *p)
     {
+      GMS_BUFFER_PROBE2(pause, p, active_ ? p - first : 0);
       if (!active_)
         return;
+      GMS_BUFFER_STAT(stats_.paused_bytes += p - first);
+      GMS_BUFFER_STAT(len_ += p - first);
+      GMS_BUFFER_STAT(++blocks_);
       buffer_copy(first, p, false);
       first = nullptr;
     }
+    const char *Caller::pending() const
+    {
+      return active_ ? first : nullptr;
+    }
+#ifdef GMS_BUFFER_STATS
+    void Caller::token_end()
+    {
+      ++stats_.tokens;
+      if (blocks_ > 1)
+        ++stats_.spanning;
+      stats_.token_length.add(len_);
+      stats_.blocks_per_token.add(blocks_);
+      len_ = 0;
+      blocks_ = 1;
+    }
+    const Stats &Caller::stats() const
+    {
+      return stats_;
+    }
+    void Caller::clear_stats()
+    {
+      stats_.clear();
+    }
+#endif
 
 
     Vector::Vector()
@@ -198,17 +348,17 @@ namespace Memory {
       if (begin == end)
         return;
 
-      if (last) {
-        if (v.empty()) {
-          if (range_.first)
-            throw logic_error("Vector::buffer_copy(..., last=true) called a 2nd time?");
-          range_.first = begin;
-          range_.second = end;
-        } else {
-          v.insert(v.end(), begin, end);
-        }
+      if (last && v.empty()) {
+        if (range_.first)
+          throw logic_error("Vector::buffer_copy(..., last=true) called a 2nd time?");
+        range_.first = begin;
+        range_.second = end;
+        GMS_BUFFER_STAT(++stats_.zero_copy);
       } else {
+        GMS_BUFFER_STAT(size_t cap = v.capacity());
         v.insert(v.end(), begin, end);
+        GMS_BUFFER_STAT(stats_.bytes_copied += end - begin);
+        GMS_BUFFER_STAT(stats_.reallocations += v.capacity() != cap);
       }
     }
     void Vector::clear()
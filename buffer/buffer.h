@@ -21,8 +21,11 @@
 #ifndef GMS_BUFFER_H
 #define GMS_BUFFER_H
 
+#include <buffer/stats.h>
+
 #include <vector>
 #include <cstddef>
+#include <initializer_list>
 #include <stdio.h>
 #include <string>
 
@@ -52,6 +55,16 @@ namespace Memory {
         virtual void buffer_copy(const char *begin, const char *end,
             bool last) = 0;
 
+        // Start of the not yet copied part of an active token,
+        // nullptr if nothing is pending or if the buffer
+        // doesn't track it.
+        //
+        // An input driver that keeps [pending(), pe) in its
+        // read buffer (possibly moved) can call resume() with
+        // the new location instead of pause() - which
+        // saves the copy.
+        virtual const char *pending() const;
+
     };
 
     class Resume {
@@ -64,9 +77,29 @@ namespace Memory {
         ~Resume();
     };
 
+    // ignores all input
+    class Null : public Base {
+      public:
+        void clear() override;
+
+        void start(const char *p) override;
+        void cont(const char *p) override;
+
+        void stop(const char *p) override;
+        void finish(const char *p) override;
+        void finish() override;
+
+        void resume(const char *p) override;
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end,
+            bool last) override;
+    };
+
     class Proxy : public Base {
       private:
-        Base *b { nullptr };
+        // never null, set(nullptr) switches to a Null buffer
+        Base *b;
       public:
         Proxy(Base *b);
         Proxy();
@@ -87,11 +120,57 @@ namespace Memory {
         void buffer_copy(const char *begin, const char *end,
             bool last) override;
 
+        const char *pending() const override;
+
+    };
+
+    // Forwards to several buffers (not owned) in one pass, e.g.
+    // to a Vector and a File. Each child tracks the token on its own,
+    // i.e. a Vector child still references a token that is located
+    // in one block.
+    class Tee : public Base {
+      private:
+        std::vector<Base*> v;
+      public:
+        Tee();
+        Tee(std::initializer_list<Base*> l);
+        void add(Base *b);
+        size_t size() const;
+
+        void clear() override;
+
+        void start(const char *p) override;
+        void cont(const char *p) override;
+
+        void stop(const char *p) override;
+        void finish(const char *p) override;
+        void finish() override;
+
+        void resume(const char *p) override;
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end,
+            bool last) override;
+
+        // only if all children agree
+        const char *pending() const override;
+
     };
 
     class Caller : public Base {
       private:
         const char* first { nullptr };
+#ifdef GMS_BUFFER_STATS
+        // of the current token
+        uint64_t len_ {0};
+        uint64_t blocks_ {1};
+        void token_end();
+      protected:
+        Stats stats_;
+      public:
+        const Stats &stats() const;
+        void clear_stats();
+#endif
       public:
         void clear() override;
 
@@ -104,6 +183,8 @@ namespace Memory {
 
         void resume(const char *p) override;
         void pause(const char *p) override;
+
+        const char *pending() const override;
     };
 
     class Vector : public Caller {
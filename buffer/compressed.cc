@@ -0,0 +1,459 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "compressed.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <zlib.h>
+#ifdef GMS_BUFFER_ZSTD
+  #include <zstd.h>
+#endif
+#ifdef GMS_BUFFER_LZ4
+  #include <lz4frame.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+using namespace std;
+
+namespace Memory {
+
+  namespace Buffer {
+
+    static const char idx_magic[6] = { 'L', 'B', 'I', 'D', 'X', '1' };
+
+    // the index is stored little-endian
+    static void put_le64(char *p, uint64_t x)
+    {
+      for (unsigned i = 0; i < 8; ++i, x >>= 8)
+        p[i] = char(x & 0xff);
+    }
+    static uint64_t get_le64(const char *p)
+    {
+      uint64_t x = 0;
+      for (unsigned i = 8; i > 0; --i)
+        x = x << 8 | static_cast<unsigned char>(p[i - 1]);
+      return x;
+    }
+
+    // z_stream counts are uInt, thus larger buffers are
+    // passed in pieces
+    static const size_t z_max = numeric_limits<uInt>::max();
+
+    struct Compressed_File::Worker {
+      Compressed_File &f;
+      // -1: default of the codec
+      int level {-1};
+      mutex m;
+      condition_variable cv;
+      bool busy {false};
+      bool stop {false};
+      unsigned pending {0};
+      exception_ptr error;
+      vector<char> out;
+      vector<Frame> index;
+      uint64_t off {0};
+      uint64_t raw_off {0};
+      z_stream z;
+      bool z_init {false};
+      thread t;
+
+      Worker(Compressed_File &f);
+      ~Worker();
+      void run();
+      void compress(const vector<char> &in);
+      size_t compress_zlib(const vector<char> &in);
+    };
+
+    Compressed_File::Worker::Worker(Compressed_File &f)
+      : f(f)
+    {
+    }
+    Compressed_File::Worker::~Worker()
+    {
+      {
+        lock_guard<mutex> l(m);
+        stop = true;
+      }
+      cv.notify_all();
+      if (t.joinable())
+        t.join();
+      if (z_init)
+        deflateEnd(&z);
+    }
+    void Compressed_File::Worker::run()
+    {
+      for (;;) {
+        unique_lock<mutex> l(m);
+        cv.wait(l, [this]() { return busy || stop; });
+        if (!busy)
+          return;
+        unsigned i = pending;
+        l.unlock();
+        // the producer doesn't touch frame i while busy
+        try {
+          if (!error)
+            compress(f.frames_[i]);
+        } catch (...) {
+          error = current_exception();
+        }
+        l.lock();
+        busy = false;
+        l.unlock();
+        cv.notify_all();
+      }
+    }
+    size_t Compressed_File::Worker::compress_zlib(const vector<char> &in)
+    {
+      if (z_init) {
+        deflateReset(&z);
+      } else {
+        memset(&z, 0, sizeof z);
+        // +16: gzip header, such that the frames are gzip members
+        if (deflateInit2(&z, level == -1 ? Z_DEFAULT_COMPRESSION : level,
+              Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+          throw runtime_error("deflateInit2 failed");
+        z_init = true;
+      }
+      out.resize(deflateBound(&z, in.size()));
+      z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+      z.avail_in = 0;
+      z.next_out = reinterpret_cast<Bytef*>(out.data());
+      z.avail_out = 0;
+      size_t in_left = in.size();
+      size_t out_left = out.size();
+      int r;
+      do {
+        if (!z.avail_in) {
+          z.avail_in = min(in_left, z_max);
+          in_left -= z.avail_in;
+        }
+        if (!z.avail_out) {
+          z.avail_out = min(out_left, z_max);
+          out_left -= z.avail_out;
+        }
+        r = deflate(&z, in_left ? Z_NO_FLUSH : Z_FINISH);
+      } while (r == Z_OK);
+      if (r != Z_STREAM_END)
+        throw runtime_error("deflate failed");
+      return out.size() - out_left - z.avail_out;
+    }
+    void Compressed_File::Worker::compress(const vector<char> &in)
+    {
+      size_t n = 0;
+      switch (f.codec_) {
+        case ZLIB:
+          n = compress_zlib(in);
+          break;
+        case ZSTD:
+#ifdef GMS_BUFFER_ZSTD
+          {
+            out.resize(ZSTD_compressBound(in.size()));
+            size_t r = ZSTD_compress(out.data(), out.size(), in.data(),
+                in.size(), level == -1 ? 3 : level);
+            if (ZSTD_isError(r))
+              throw runtime_error(string("ZSTD_compress: ")
+                  + ZSTD_getErrorName(r));
+            n = r;
+          }
+#endif
+          break;
+        case LZ4:
+#ifdef GMS_BUFFER_LZ4
+          {
+            LZ4F_preferences_t p;
+            memset(&p, 0, sizeof p);
+            p.compressionLevel = level == -1 ? 0 : level;
+            out.resize(LZ4F_compressFrameBound(in.size(), &p));
+            size_t r = LZ4F_compressFrame(out.data(), out.size(), in.data(),
+                in.size(), &p);
+            if (LZ4F_isError(r))
+              throw runtime_error(string("LZ4F_compressFrame: ")
+                  + LZ4F_getErrorName(r));
+            n = r;
+          }
+#endif
+          break;
+      }
+      f.file_.buffer_copy(out.data(), out.data() + n, false);
+      index.push_back(Frame { off, n, raw_off, in.size() });
+      off += n;
+      raw_off += in.size();
+    }
+
+    Compressed_File::Compressed_File(const std::string &dir,
+        const std::string &filename, Codec codec, size_t frame_size,
+        bool exclusive)
+      : dir_(dir), filename_(filename), exclusive_(exclusive),
+        codec_(codec), frame_size_(frame_size)
+    {
+      if (!available(codec))
+        throw logic_error("Compressed_File: codec not available");
+      if (!frame_size)
+        throw logic_error("Compressed_File: frame size must not be zero");
+      file_.open(dir, filename, exclusive);
+      for (auto &f : frames_)
+        f.reserve(frame_size);
+      w_.reset(new Worker(*this));
+    }
+    Compressed_File::~Compressed_File()
+    {
+      try {
+        close();
+      } catch (const exception &) {
+      }
+    }
+    void Compressed_File::set_level(int level)
+    {
+      if (frames_count_)
+        throw logic_error("Compressed_File: level set after first frame");
+      w_->level = level;
+    }
+    void Compressed_File::set_sync(bool b)
+    {
+      sync_ = b;
+      file_.set_sync(b);
+    }
+    uint64_t Compressed_File::frames() const
+    {
+      return frames_count_;
+    }
+
+    void Compressed_File::handoff()
+    {
+      Worker &w = *w_;
+      {
+        unique_lock<mutex> l(w.m);
+        w.cv.wait(l, [&w]() { return !w.busy; });
+        if (w.error)
+          rethrow_exception(w.error);
+        w.pending = cur_;
+        w.busy = true;
+        if (!w.t.joinable())
+          w.t = thread(&Worker::run, &w);
+      }
+      w.cv.notify_all();
+      ++frames_count_;
+      cur_ ^= 1;
+      frames_[cur_].clear();
+    }
+
+    void Compressed_File::close()
+    {
+      if (!w_)
+        return;
+      exception_ptr error;
+      try {
+        if (!frames_[cur_].empty())
+          handoff();
+      } catch (...) {
+        error = current_exception();
+      }
+      vector<Frame> index;
+      {
+        Worker &w = *w_;
+        {
+          lock_guard<mutex> l(w.m);
+          w.stop = true;
+        }
+        // the worker finishes the pending frame first
+        w.cv.notify_all();
+        if (w.t.joinable())
+          w.t.join();
+        if (!error)
+          error = w.error;
+        index.swap(w.index);
+      }
+      w_.reset();
+      if (error) {
+        try {
+          file_.close();
+        } catch (const exception &) {
+        }
+        rethrow_exception(error);
+      }
+      file_.close();
+
+      File idx(dir_, filename_ + ".idx", exclusive_);
+      idx.set_sync(sync_);
+      char header[8] = { 0 };
+      memcpy(header, idx_magic, sizeof idx_magic);
+      header[6] = char(codec_);
+      idx.buffer_copy(header, header + sizeof header, false);
+      for (auto &f : index) {
+        char v[4 * 8];
+        put_le64(v, f.off);
+        put_le64(v + 8, f.len);
+        put_le64(v + 16, f.raw_off);
+        put_le64(v + 24, f.raw_len);
+        idx.buffer_copy(v, v + sizeof v, false);
+      }
+      idx.close();
+    }
+
+    void Compressed_File::clear()
+    {
+    }
+
+    void Compressed_File::buffer_copy(const char *begin, const char *end,
+        bool /* last */)
+    {
+      if (!w_)
+        throw logic_error("Compressed_File::buffer_copy() - file closed");
+      while (begin != end) {
+        vector<char> &f = frames_[cur_];
+        size_t k = min(size_t(end - begin), frame_size_ - f.size());
+        f.insert(f.end(), begin, begin + k);
+        begin += k;
+        if (f.size() == frame_size_)
+          handoff();
+      }
+    }
+
+    bool Compressed_File::available(Codec codec)
+    {
+      switch (codec) {
+        case ZLIB:
+          return true;
+        case ZSTD:
+#ifdef GMS_BUFFER_ZSTD
+          return true;
+#else
+          return false;
+#endif
+        case LZ4:
+#ifdef GMS_BUFFER_LZ4
+          return true;
+#else
+          return false;
+#endif
+      }
+      return false;
+    }
+
+    std::vector<Compressed_File::Frame> Compressed_File::read_index(
+        const std::string &filename, Codec *codec)
+    {
+      vector<char> v;
+      int fd = posix::open(filename.c_str(), O_RDONLY);
+      try {
+        char b[64 * 1024];
+        for (;;) {
+          size_t n = posix::read(fd, b, sizeof b);
+          if (!n)
+            break;
+          v.insert(v.end(), b, b + n);
+        }
+      } catch (...) {
+        ::close(fd);
+        throw;
+      }
+      posix::close(fd);
+      if (v.size() < 8 || memcmp(v.data(), idx_magic, sizeof idx_magic)
+          || (v.size() - 8) % (4 * sizeof(uint64_t)))
+        throw runtime_error("Compressed_File: no index file: " + filename);
+      if (codec)
+        *codec = Codec(v[6]);
+      vector<Frame> r((v.size() - 8) / (4 * sizeof(uint64_t)));
+      for (size_t i = 0; i < r.size(); ++i) {
+        const char *x = v.data() + 8 + i * 4 * sizeof(uint64_t);
+        r[i] = Frame { get_le64(x), get_le64(x + 8), get_le64(x + 16),
+          get_le64(x + 24) };
+      }
+      return r;
+    }
+
+    void Compressed_File::decompress(Codec codec, const Frame &f,
+        const char *in, std::vector<char> &out)
+    {
+      out.resize(f.raw_len);
+      switch (codec) {
+        case ZLIB:
+          {
+            z_stream z;
+            memset(&z, 0, sizeof z);
+            if (inflateInit2(&z, 15 + 16) != Z_OK)
+              throw runtime_error("inflateInit2 failed");
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+            z.next_out = reinterpret_cast<Bytef*>(out.data());
+            size_t in_left = f.len;
+            size_t out_left = out.size();
+            int r;
+            do {
+              if (!z.avail_in) {
+                z.avail_in = min(in_left, z_max);
+                in_left -= z.avail_in;
+              }
+              if (!z.avail_out) {
+                z.avail_out = min(out_left, z_max);
+                out_left -= z.avail_out;
+              }
+              r = inflate(&z, Z_NO_FLUSH);
+            } while (r == Z_OK);
+            inflateEnd(&z);
+            if (r != Z_STREAM_END || out_left || z.avail_out)
+              throw runtime_error("inflate: corrupt frame");
+          }
+          return;
+        case ZSTD:
+#ifdef GMS_BUFFER_ZSTD
+          {
+            size_t r = ZSTD_decompress(out.data(), out.size(), in, f.len);
+            if (ZSTD_isError(r) || r != f.raw_len)
+              throw runtime_error("ZSTD_decompress: corrupt frame");
+          }
+          return;
+#else
+          break;
+#endif
+        case LZ4:
+#ifdef GMS_BUFFER_LZ4
+          {
+            LZ4F_dctx *ctx = nullptr;
+            if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx,
+                    LZ4F_VERSION)))
+              throw runtime_error("LZ4F_createDecompressionContext failed");
+            size_t dst = out.size();
+            size_t src = f.len;
+            size_t r = LZ4F_decompress(ctx, out.data(), &dst, in, &src,
+                nullptr);
+            LZ4F_freeDecompressionContext(ctx);
+            if (r != 0 || dst != f.raw_len)
+              throw runtime_error("LZ4F_decompress: corrupt frame");
+          }
+          return;
+#else
+          break;
+#endif
+      }
+      throw logic_error("Compressed_File: codec not available");
+    }
+
+  }
+}
@@ -0,0 +1,110 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_COMPRESSED_H
+#define GMS_BUFFER_COMPRESSED_H
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Like File, but the output is compressed.
+    //
+    // buffer_copy() only copies into a staging frame - a full frame is
+    // compressed and written by a worker thread while the next
+    // frame is filled (double buffering). Each frame is compressed
+    // independently (zlib: one gzip member, i.e. the file can be
+    // read by zcat; zstd/lz4: one frame, if available at build time).
+    //
+    // On close(), an index of the frames is written to FILENAME.idx
+    // (little-endian), such that a capture can be decompressed frame
+    // by frame, e.g. in parallel, cf. read_index() and decompress().
+    //
+    // Only built when zlib is available.
+    class Compressed_File : public Caller {
+      public:
+        enum Codec { ZLIB, ZSTD, LZ4 };
+        struct Frame {
+          // compressed
+          uint64_t off;
+          uint64_t len;
+          // uncompressed
+          uint64_t raw_off;
+          uint64_t raw_len;
+        };
+      private:
+        struct Worker;
+        File file_;
+        std::string dir_;
+        std::string filename_;
+        bool exclusive_;
+        bool sync_ {true};
+        Codec codec_;
+        size_t frame_size_;
+        std::vector<char> frames_[2];
+        unsigned cur_ {0};
+        uint64_t frames_count_ {0};
+        // last member, such that the thread is stopped first
+        std::unique_ptr<Worker> w_;
+
+        void handoff();
+      public:
+        Compressed_File(const Compressed_File &) =delete;
+        Compressed_File &operator=(const Compressed_File &) =delete;
+
+        Compressed_File(const std::string &dir, const std::string &filename,
+            Codec codec = ZLIB, size_t frame_size = 1024 * 1024,
+            bool exclusive = true);
+        ~Compressed_File();
+        // before the first frame is written,
+        // default: the default of the codec
+        void set_level(int level);
+        void set_sync(bool b);
+        // compresses the last frame, waits for the worker and
+        // writes the index
+        void close();
+        uint64_t frames() const;
+
+        void clear() override;
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override;
+
+        static bool available(Codec codec);
+        static std::vector<Frame> read_index(const std::string &filename,
+            Codec *codec = nullptr);
+        // decompresses one frame of f.len bytes into out (f.raw_len)
+        static void decompress(Codec codec, const Frame &f, const char *in,
+            std::vector<char> &out);
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_DRIVER_H
+#define GMS_BUFFER_DRIVER_H
+
+#include <utility>
+
+namespace Memory {
+
+  // The read loop of Reader, Map_Reader and Ring_Reader - over the
+  // refill() of the derived class, which returns the next input
+  // block, or an empty range at the end of the input.
+  template <typename Derived> class Driver {
+    public:
+      // Gets the next block and calls f(p, pe) with the new input.
+      //
+      // Returns false at the end of the input - then, the remainder
+      // of an active token is copied into the buffer (via pause()),
+      // i.e. it can be completed with Base::finish().
+      template <typename F> bool next(F f)
+      {
+        std::pair<const char*, const char*> r(
+            static_cast<Derived*>(this)->refill());
+        if (r.first == r.second)
+          return false;
+        f(r.first, r.second);
+        return true;
+      }
+      template <typename F> void run(F f)
+      {
+        while (next(f))
+          ;
+      }
+  };
+
+}
+
+#endif
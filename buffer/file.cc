@@ -23,11 +23,23 @@
 #include <ixxx/ixxx.h>
 using namespace ixxx;
 
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
 #include <stdexcept>
 using namespace std;
 
 namespace Memory {
 
+  // alignment of buffers and writes, also for O_DIRECT
+  static const size_t direct_align = 4096;
+
   Dir::Dir()
   {
   }
@@ -42,13 +54,41 @@ namespace Memory {
   {
     o.path_.clear();
     o.fd_ = -1;
+    lock_guard<mutex> lock(o.m_);
+    group_ = o.group_;
+    syncfs_ = o.syncfs_;
+    max_pending_ = o.max_pending_;
+    max_delay_ = o.max_delay_;
+    pending_ = std::move(o.pending_);
+    o.pending_.clear();
+    oldest_ = o.oldest_;
+    added_ = o.added_;
+    committed_ = o.committed_;
+    failed_ = o.failed_;
+    commits_ = o.commits_;
   }
   Dir &Dir::operator=(Dir &&o)
   {
+    if (this == &o)
+      return *this;
+    // commits our pending files and closes our descriptor
+    close();
     path_ = o.path_;
     o.path_.clear();
     fd_ = o.fd_;
     o.fd_ = -1;
+    lock_guard<mutex> lock(o.m_);
+    group_ = o.group_;
+    syncfs_ = o.syncfs_;
+    max_pending_ = o.max_pending_;
+    max_delay_ = o.max_delay_;
+    pending_ = std::move(o.pending_);
+    o.pending_.clear();
+    oldest_ = o.oldest_;
+    added_ = o.added_;
+    committed_ = o.committed_;
+    failed_ = o.failed_;
+    commits_ = o.commits_;
     return *this;
   }
   Dir::Dir(const std::string &path)
@@ -90,51 +130,323 @@ namespace Memory {
   }
   void Dir::close()
   {
+    if (fd_ == -1)
+      return;
+    try {
+      commit();
+    } catch (...) {
+      if (!path_.empty()) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+      throw;
+    }
     // when fd was supplied via constructor
     if (path_.empty())
       return;
-    if (fd_ == -1)
+    int fd = fd_;
+    fd_ = -1;
+    posix::close(fd);
+  }
+
+  void Dir::set_group_commit(bool b)
+  {
+    group_ = b;
+    if (!b)
+      commit();
+  }
+  bool Dir::group_commit() const
+  {
+    return group_;
+  }
+  void Dir::set_max_pending(size_t n)
+  {
+    max_pending_ = n;
+  }
+  void Dir::set_max_delay(std::chrono::milliseconds d)
+  {
+    max_delay_ = d;
+  }
+  void Dir::set_syncfs(bool b)
+  {
+    syncfs_ = b;
+  }
+  size_t Dir::commits() const
+  {
+    return commits_;
+  }
+  uint64_t Dir::add(int fd, std::function<void()> publish,
+      std::function<void()> discard)
+  {
+    uint64_t ticket = 0;
+    bool due = false;
+    {
+      lock_guard<mutex> lock(m_);
+      auto now = chrono::steady_clock::now();
+      if (pending_.empty())
+        oldest_ = now;
+      pending_.push_back(Pending{fd, std::move(publish),
+          std::move(discard)});
+      ticket = ++added_;
+      due = pending_.size() >= max_pending_ || now - oldest_ >= max_delay_;
+    }
+    if (due)
+      commit();
+    return ticket;
+  }
+  void Dir::poll()
+  {
+    bool due = false;
+    {
+      lock_guard<mutex> lock(m_);
+      due = !pending_.empty()
+        && chrono::steady_clock::now() - oldest_ >= max_delay_;
+    }
+    if (due)
+      commit();
+  }
+  void Dir::commit()
+  {
+    lock_guard<mutex> commit_lock(commit_m_);
+    vector<Pending> fds;
+    uint64_t ticket = 0;
+    {
+      lock_guard<mutex> lock(m_);
+      fds.swap(pending_);
+      ticket = added_;
+    }
+    if (fds.empty())
       return;
-    posix::close(fd_);
+    // the tickets of the batch are consecutive
+    uint64_t lo = ticket - fds.size() + 1;
+    vector<pair<uint64_t, uint64_t> > failed;
+    string errors;
+    try {
+      try {
+        if (syncfs_ && fds.size() > 1) {
+          Buffer::Timer t;
+          if (syncfs(fds.front().fd) == -1)
+            throw runtime_error(string("syncfs: ") + strerror(errno));
+          fsynced(fds.front().fd, t.ns());
+        } else {
+          for (auto &p : fds) {
+            Buffer::Timer t;
+            posix::fsync(p.fd);
+            fsynced(p.fd, t.ns());
+          }
+        }
+      } catch (...) {
+        // e.g. unlink temporary names, nothing is published
+        for (auto &p : fds)
+          if (p.discard)
+            p.discard();
+        throw;
+      }
+      // i.e. link the synced files, such that all new directory
+      // entries are covered by the one directory fsync - a failed
+      // publish doesn't keep the others from being published
+      for (size_t i = 0; i < fds.size(); ++i) {
+        if (!fds[i].publish)
+          continue;
+        try {
+          fds[i].publish();
+        } catch (const exception &e) {
+          if (!errors.empty())
+            errors += "; ";
+          errors += e.what();
+          failed.emplace_back(lo + i, lo + i);
+        }
+      }
+      Buffer::Timer t;
+      fsync();
+      fsynced(fd_, t.ns());
+    } catch (...) {
+      for (auto &p : fds)
+        ::close(p.fd);
+      lock_guard<mutex> lock(m_);
+      failed_.emplace_back(lo, ticket);
+      committed_ = ticket;
+      throw;
+    }
+    for (auto &p : fds)
+      posix::close(p.fd);
+    lock_guard<mutex> lock(m_);
+    failed_.insert(failed_.end(), failed.begin(), failed.end());
+    committed_ = ticket;
+    ++commits_;
+    if (!errors.empty())
+      throw runtime_error("Dir::commit() - publish failed: " + errors);
+  }
+  void Dir::fsynced(int fd, uint64_t ns)
+  {
+    (void)fd;
+    (void)ns;
+    GMS_BUFFER_STAT(fsync_ns_.add(ns));
+    GMS_BUFFER_PROBE2(fsync, fd, ns);
+  }
+#ifdef GMS_BUFFER_STATS
+  const Buffer::Histogram &Dir::fsync_ns() const
+  {
+    return fsync_ns_;
+  }
+#endif
+  bool Dir::failed(uint64_t ticket) const
+  {
+    for (auto &r : failed_)
+      if (r.first <= ticket && ticket <= r.second)
+        return true;
+    return false;
+  }
+  void Dir::wait(uint64_t ticket)
+  {
+    for (;;) {
+      {
+        lock_guard<mutex> lock(m_);
+        if (ticket > added_)
+          throw logic_error("Dir::wait() - unknown ticket");
+        if (failed(ticket))
+          throw runtime_error("Dir::wait() - commit failed");
+        if (committed_ >= ticket)
+          return;
+      }
+      try {
+        commit();
+      } catch (const exception &) {
+        // the outcome of the ticket is checked above
+      }
+    }
   }
 
 
+  // hidden temporary name in the same directory as name
+  static string temp_name(const string &name)
+  {
+    static atomic<unsigned> counter {0};
+    size_t i = name.rfind('/');
+    i = i == string::npos ? 0 : i + 1;
+    return name.substr(0, i) + '.' + name.substr(i) + '.'
+      + to_string(getpid()) + '.' + to_string(counter++) + ".tmp";
+  }
+
+  int open_tmpfile(int dir_fd, const char *dir, const string &name,
+      int flags, unsigned mode, string &tmp_name)
+  {
+    int fd = ::openat(dir_fd, dir, O_TMPFILE | flags, mode);
+    if (fd != -1)
+      return fd;
+    if (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL)
+      throw runtime_error(string("open: ") + dir + ": " + strerror(errno));
+    // file system doesn't support O_TMPFILE
+    tmp_name = temp_name(name);
+    return posix::openat(dir_fd, tmp_name.c_str(), O_CREAT | O_EXCL | flags,
+        mode);
+  }
+
+  // Links a file that was written under the temporary name tmp - or
+  // as anonymous O_TMPFILE if tmp is empty - as name. Names are
+  // relative to dir_fd. When exclusive, an existing name isn't replaced.
+  static void publish(int fd, int dir_fd, const string &name,
+      const string &tmp, bool exclusive)
+  {
+    string src(tmp);
+    if (tmp.empty()) {
+      // linkat() with AT_EMPTY_PATH requires CAP_DAC_READ_SEARCH,
+      // cf. the linux man page of open(), the /proc link doesn't
+      string proc("/proc/self/fd/" + to_string(fd));
+      if (exclusive) {
+        if (linkat(AT_FDCWD, proc.c_str(), dir_fd, name.c_str(),
+              AT_SYMLINK_FOLLOW) == -1)
+          throw runtime_error(string("linkat: ") + name + ": "
+              + strerror(errno));
+        return;
+      }
+      src = temp_name(name);
+      if (linkat(AT_FDCWD, proc.c_str(), dir_fd, src.c_str(),
+            AT_SYMLINK_FOLLOW) == -1) {
+        int e = errno;
+        // an existing src isn't ours
+        if (e != EEXIST)
+          unlinkat(dir_fd, src.c_str(), 0);
+        throw runtime_error(string("linkat: ") + src + ": " + strerror(e));
+      }
+    } else if (exclusive) {
+      if (linkat(dir_fd, src.c_str(), dir_fd, name.c_str(), 0) == -1) {
+        int e = errno;
+        unlinkat(dir_fd, src.c_str(), 0);
+        throw runtime_error(string("linkat: ") + name + ": " + strerror(e));
+      }
+      if (unlinkat(dir_fd, src.c_str(), 0) == -1)
+        throw runtime_error(string("unlinkat: ") + strerror(errno));
+      return;
+    }
+    if (renameat(dir_fd, src.c_str(), dir_fd, name.c_str()) == -1) {
+      int e = errno;
+      unlinkat(dir_fd, src.c_str(), 0);
+      throw runtime_error(string("renameat: ") + name + ": " + strerror(e));
+    }
+  }
+
   namespace Buffer {
 
     File::File()
     {
     }
-    File::File(const string &dir, const string &filename, bool exclusive)
+    File::File(const string &dir, const string &filename, bool exclusive,
+        unsigned flags)
     {
-      open(dir, filename, exclusive);
+      open(dir, filename, exclusive, flags);
     }
-    File::File(Dir &dir, const std::string &filename, bool exclusive)
+    File::File(Dir &dir, const std::string &filename, bool exclusive,
+        unsigned flags)
       : dir_(&dir)
     {
-      open(filename, exclusive);
+      open(filename, exclusive, flags);
     }
     File::File(File &&o)
       : dir_(o.dir_), dir_path_(std::move(o.dir_path_)),
-          fd(o.fd), f(o.f), filename_(std::move(o.filename_)),
-          sync_(o.sync_)
+          fd(o.fd), filename_(std::move(o.filename_)),
+          sync_(o.sync_), buf_(o.buf_), buf_size_(o.buf_size_),
+          buf_len_(o.buf_len_), ticket_(o.ticket_), direct_(o.direct_),
+          off_(o.off_), wb_interval_(o.wb_interval_), wb_off_(o.wb_off_),
+          atomic_(o.atomic_), exclusive_(o.exclusive_),
+          tmp_name_(std::move(o.tmp_name_)), failed_(o.failed_)
     {
       o.dir_ = nullptr;
       o.dir_path_.clear();
       o.fd = -1;
-      o.f = nullptr;
       o.filename_.clear();
       o.sync_ = false;
+      o.buf_ = nullptr;
+      o.buf_len_ = 0;
+      o.atomic_ = false;
+      o.tmp_name_.clear();
     }
     File &File::operator=(File &&o)
     {
+      close();
+      release();
       dir_ = o.dir_;
       o.dir_ = nullptr;
       dir_path_ = std::move(o.dir_path_);
       o.dir_path_.clear();
       fd = o.fd;
       o.fd = -1;
-      f = o.f;
-      o.f = nullptr;
+      buf_ = o.buf_;
+      o.buf_ = nullptr;
+      buf_size_ = o.buf_size_;
+      buf_len_ = o.buf_len_;
+      o.buf_len_ = 0;
+      ticket_ = o.ticket_;
+      direct_ = o.direct_;
+      off_ = o.off_;
+      wb_interval_ = o.wb_interval_;
+      wb_off_ = o.wb_off_;
+      atomic_ = o.atomic_;
+      o.atomic_ = false;
+      exclusive_ = o.exclusive_;
+      tmp_name_ = std::move(o.tmp_name_);
+      o.tmp_name_.clear();
+      failed_ = o.failed_;
       filename_ = std::move(o.filename_);
       o.filename_.clear();
       sync_ = o.sync_;
@@ -150,16 +462,89 @@ namespace Memory {
         // we must not throw an exception from a destructor
         (void)0;
       }
+      release();
+    }
+    void File::release()
+    {
+      free(buf_);
+      buf_ = nullptr;
+      buf_len_ = 0;
     }
     void File::set_sync(bool b)
     {
       sync_ = b;
     }
-    void File::open(const std::string &dir, const char *filename, bool exclusive)
+    void File::set_buffer_size(size_t n)
     {
-      return open(dir, string(filename), exclusive);
+      if (!n)
+        throw logic_error("File::set_buffer_size() - size must not be zero");
+      flush();
+      if (direct_)
+        n = (n + direct_align - 1) / direct_align * direct_align;
+      // in direct mode, an unaligned tail is left
+      char *tail = buf_;
+      size_t tail_len = buf_len_;
+      buf_ = nullptr;
+      buf_size_ = n;
+      buf_len_ = 0;
+      if (tail_len) {
+        allocate();
+        memcpy(buf_, tail, tail_len);
+        buf_len_ = tail_len;
+      }
+      free(tail);
+    }
+    void File::allocate()
+    {
+      if (buf_)
+        return;
+      void *p = nullptr;
+      if (posix_memalign(&p, direct_align, buf_size_))
+        throw bad_alloc();
+      buf_ = static_cast<char*>(p);
+    }
+    void File::opened(unsigned flags)
+    {
+      failed_ = false;
+      direct_ = false;
+      off_ = 0;
+      wb_off_ = 0;
+      if (!(flags & DIRECT))
+        return;
+      // set afterwards, such that we can fall back
+      // when the file system doesn't support it
+      int fl = fcntl(fd, F_GETFL);
+      if (fl == -1)
+        throw runtime_error(string("fcntl: ") + strerror(errno));
+      if (fcntl(fd, F_SETFL, fl | O_DIRECT) == -1) {
+        if (errno == EINVAL)
+          return;
+        throw runtime_error(string("fcntl: ") + strerror(errno));
+      }
+      direct_ = true;
+      size_t n = (buf_size_ + direct_align - 1) / direct_align * direct_align;
+      // a buffer of a previous (non-direct) file might be too small
+      if (n != buf_size_) {
+        release();
+        buf_size_ = n;
+      }
     }
-    void File::open(const string &dir, const string &filename, bool exclusive)
+    void File::open_atomic(int dir_fd, const string &name)
+    {
+      // mirror O_EXCL, although linkat() would fail on close, anyway
+      if (exclusive_ && faccessat(dir_fd, name.c_str(), F_OK, 0) == 0)
+        throw runtime_error(string("open: ") + name + ": "
+            + strerror(EEXIST));
+      const char *d = dir_fd == AT_FDCWD ? dir_path_.c_str() : ".";
+      fd = open_tmpfile(dir_fd, d, name, O_WRONLY, 0666, tmp_name_);
+    }
+    void File::open(const std::string &dir, const char *filename,
+        bool exclusive, unsigned flags)
+    {
+      return open(dir, string(filename), exclusive, flags);
+    }
+    void File::open(const string &dir, const string &filename, bool exclusive,
+        unsigned flags)
     {
       close();
       dir_path_ = dir;
@@ -169,52 +554,296 @@ namespace Memory {
       fn += '/';
       fn += filename;
 
-      int flags = O_CREAT | O_WRONLY;
-      if (exclusive)
-        flags |= O_EXCL;
-      fd = posix::open(fn.c_str(), flags, 0666);
-      f = posix::fdopen(fd, "wb");
+      atomic_ = flags & ATOMIC;
+      exclusive_ = exclusive;
+      tmp_name_.clear();
+      if (atomic_) {
+        open_atomic(AT_FDCWD, fn);
+      } else {
+        int o_flags = O_CREAT | O_WRONLY;
+        if (exclusive)
+          o_flags |= O_EXCL;
+        fd = posix::open(fn.c_str(), o_flags, 0666);
+      }
+      opened(flags);
     }
-    void File::open(const string &filename, bool exclusive)
+    void File::open(const string &filename, bool exclusive, unsigned flags)
     {
       close();
       filename_ = filename;
-      int flags = O_CREAT | O_WRONLY;
-      if (exclusive)
-        flags |= O_EXCL;
-      fd = posix::openat(dir_->fd(), filename.c_str(), flags, 0666);
-      f = posix::fdopen(fd, "wb");
+      atomic_ = flags & ATOMIC;
+      exclusive_ = exclusive;
+      tmp_name_.clear();
+      if (atomic_) {
+        open_atomic(dir_->fd(), filename);
+      } else {
+        int o_flags = O_CREAT | O_WRONLY;
+        if (exclusive)
+          o_flags |= O_EXCL;
+        fd = posix::openat(dir_->fd(), filename.c_str(), o_flags, 0666);
+      }
+      opened(flags);
+    }
+    void File::discard()
+    {
+      int t = fd;
+      fd = -1;
+      direct_ = false;
+      buf_len_ = 0;
+      ::close(t);
+      // an anonymous O_TMPFILE just vanishes
+      if (atomic_ && !tmp_name_.empty())
+        unlinkat(dir_ ? dir_->fd() : AT_FDCWD, tmp_name_.c_str(), 0);
     }
     void File::close()
     {
-      if (!f)
+      if (fd == -1)
         return;
-      ansi::fflush(f);
-      if (sync_) {
-        int fd = posix::fileno(f);
-        posix::fsync(fd);
+      if (failed_) {
+        discard();
+        throw runtime_error("File::close() - " + filename_
+            + ": discarded after a write error");
       }
-      ansi::fclose(f);
-      f = nullptr;
+      int at_fd = dir_ ? dir_->fd() : AT_FDCWD;
+      string name(dir_ ? filename_ : dir_path_ + '/' + filename_);
+      bool group = sync_ && dir_ && dir_->group_commit();
+      try {
+        flush();
+        if (direct_)
+          close_direct();
+        if (sync_ && !group) {
+          Timer t;
+          posix::fsync(fd);
+          fsynced(fd, t.ns());
+        }
+      } catch (...) {
+        failed_ = true;
+        discard();
+        throw;
+      }
+      if (group) {
+        int t = fd;
+        fd = -1;
+        if (atomic_) {
+          string tmp(tmp_name_);
+          bool exclusive = exclusive_;
+          std::function<void()> discard;
+          if (!tmp.empty())
+            discard = [at_fd, tmp]() { unlinkat(at_fd, tmp.c_str(), 0); };
+          ticket_ = dir_->add(t, [t, at_fd, name, tmp, exclusive]() {
+              publish(t, at_fd, name, tmp, exclusive); }, discard);
+        } else {
+          ticket_ = dir_->add(t);
+        }
+        return;
+      }
+      if (atomic_) {
+        try {
+          publish(fd, at_fd, name, tmp_name_, exclusive_);
+        } catch (...) {
+          discard();
+          throw;
+        }
+      }
+      int t = fd;
+      fd = -1;
+      posix::close(t);
       if (sync_) {
+        Timer t;
         if (dir_) {
           dir_->fsync();
+          fsynced(dir_->fd(), t.ns());
         } else {
           // such that new file directory entries are sync'd as well
           // cf. linux man page of fsync()
           int dir_fd = posix::open(dir_path_.c_str(), O_RDONLY);
           posix::fsync(dir_fd);
           posix::close(dir_fd);
+          fsynced(dir_fd, t.ns());
         }
       }
     }
+    void File::fsynced(int fd, uint64_t ns)
+    {
+      (void)fd;
+      (void)ns;
+      GMS_BUFFER_STAT(stats_.fsync_ns.add(ns));
+      GMS_BUFFER_PROBE2(fsync, fd, ns);
+    }
+    uint64_t File::ticket() const
+    {
+      return ticket_;
+    }
+    bool File::direct() const
+    {
+      return direct_;
+    }
+    bool File::atomic() const
+    {
+      return atomic_;
+    }
     void File::clear()
     {
     }
 
+    void File::write(struct iovec *v, int n)
+    {
+      for (int i = 0; i < n; ++i)
+        off_ += v[i].iov_len;
+      while (n) {
+        ssize_t r = ::writev(fd, v, n);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          failed_ = true;
+          throw runtime_error(string("writev: ") + strerror(errno));
+        }
+        size_t k = r;
+        // skip what was written, partial writes are possible
+        for (; n && k >= v->iov_len; ++v, --n)
+          k -= v->iov_len;
+        if (n) {
+          v->iov_base = static_cast<char*>(v->iov_base) + k;
+          v->iov_len -= k;
+        }
+      }
+      writeback();
+    }
+    void File::writeback()
+    {
+      if (!wb_interval_ || direct_)
+        return;
+      while (off_ - wb_off_ >= wb_interval_) {
+        if (sync_file_range(fd, wb_off_, wb_interval_,
+              SYNC_FILE_RANGE_WRITE) == -1) {
+          failed_ = true;
+          throw runtime_error(string("sync_file_range: ") + strerror(errno));
+        }
+        if (wb_off_ >= wb_interval_) {
+          uint64_t prev = wb_off_ - wb_interval_;
+          if (sync_file_range(fd, prev, wb_interval_,
+                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE
+                | SYNC_FILE_RANGE_WAIT_AFTER) == -1) {
+            failed_ = true;
+            throw runtime_error(string("sync_file_range: ")
+                + strerror(errno));
+          }
+          // just a hint
+          posix_fadvise(fd, prev, wb_interval_, POSIX_FADV_DONTNEED);
+        }
+        wb_off_ += wb_interval_;
+      }
+    }
+    void File::preallocate(uint64_t n)
+    {
+      if (fd == -1)
+        throw logic_error("File::preallocate() - file not opened");
+      if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, n) == -1) {
+        if (errno == EOPNOTSUPP)
+          return;
+        throw runtime_error(string("fallocate: ") + strerror(errno));
+      }
+    }
+    void File::splice(int pipe_fd, size_t n)
+    {
+      if (fd == -1)
+        throw logic_error("File::splice() - file not opened");
+      if (direct_)
+        throw logic_error("File::splice() - not available in direct mode");
+      flush();
+      while (n) {
+        ssize_t r = ::splice(pipe_fd, nullptr, fd, nullptr, n, SPLICE_F_MOVE);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          failed_ = true;
+          throw runtime_error(string("splice: ") + strerror(errno));
+        }
+        if (!r) {
+          failed_ = true;
+          throw runtime_error("File::splice() - unexpected end of input");
+        }
+        n -= r;
+        off_ += r;
+      }
+      writeback();
+    }
+    void File::set_writeback(size_t n)
+    {
+      wb_interval_ = n;
+      wb_off_ = off_ - off_ % (n ? n : 1);
+    }
+    void File::write_direct(size_t n)
+    {
+      if (!n)
+        return;
+      struct iovec v = { buf_, n };
+      write(&v, 1);
+      buf_len_ -= n;
+      memmove(buf_, buf_ + n, buf_len_);
+    }
+    void File::close_direct()
+    {
+      if (buf_len_) {
+        uint64_t size = off_ + buf_len_;
+        size_t n = (buf_len_ + direct_align - 1) / direct_align * direct_align;
+        memset(buf_ + buf_len_, 0, n - buf_len_);
+        buf_len_ = n;
+        write_direct(n);
+        posix::ftruncate(fd, size);
+      }
+      direct_ = false;
+    }
+    void File::flush()
+    {
+      if (direct_) {
+        write_direct(buf_len_ / direct_align * direct_align);
+        return;
+      }
+      if (!buf_len_)
+        return;
+      struct iovec v = { buf_, buf_len_ };
+      buf_len_ = 0;
+      write(&v, 1);
+    }
+
     void File::buffer_copy(const char *begin, const char *end, bool /* last */)
     {
-      ansi::fwrite(begin, 1, end-begin, f);
+      if (begin == end)
+        return;
+      if (fd == -1)
+        throw logic_error("File::buffer_copy() - file not opened");
+      size_t n = end - begin;
+      if (direct_) {
+        allocate();
+        GMS_BUFFER_STAT(stats_.bytes_copied += n);
+        while (n) {
+          size_t k = min(n, buf_size_ - buf_len_);
+          memcpy(buf_ + buf_len_, begin, k);
+          buf_len_ += k;
+          begin += k;
+          n -= k;
+          if (buf_len_ == buf_size_)
+            write_direct(buf_size_);
+        }
+        return;
+      }
+      if (buf_len_ + n <= buf_size_) {
+        allocate();
+        GMS_BUFFER_STAT(stats_.bytes_copied += n);
+        memcpy(buf_ + buf_len_, begin, n);
+        buf_len_ += n;
+        return;
+      }
+      struct iovec v[2] = {
+        { buf_, buf_len_ },
+        { const_cast<char*>(begin), n }
+      };
+      buf_len_ = 0;
+      if (v[0].iov_len)
+        write(v, 2);
+      else
+        write(v + 1, 1);
     }
 
 
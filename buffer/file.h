@@ -23,12 +23,67 @@
 
 #include <buffer/buffer.h>
 
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+struct iovec;
+
 namespace Memory {
 
+  // A directory that files are created in, via openat().
+  //
+  // In group commit mode, closing a Buffer::File (with sync enabled)
+  // just registers its descriptor as pending. A commit then
+  // fsyncs all pending files (or the whole file system, via syncfs()),
+  // fsyncs the directory just once and closes the files.
+  // A commit is done when the number of pending files or the age
+  // of the oldest one exceeds a limit (checked when a file is added
+  // and on poll()), on an explicit commit() and when the directory
+  // is closed. Thus, without poll() calls, an idle Dir doesn't
+  // commit its pending files in time.
+  // Files opened with the File::ATOMIC flag are published (i.e. linked
+  // under their final name) by the commit, after their data is synced
+  // and before the directory is.
   class Dir {
     private:
       std::string path_;
       int fd_ {-1};
+
+      bool group_ {false};
+      bool syncfs_ {false};
+      size_t max_pending_ {64};
+      std::chrono::milliseconds max_delay_ {100};
+      struct Pending {
+        int fd;
+        std::function<void()> publish;
+        // called instead of publish when the sync fails
+        std::function<void()> discard;
+      };
+      std::vector<Pending> pending_;
+      std::chrono::steady_clock::time_point oldest_;
+      uint64_t added_ {0};
+      // highest ticket whose batch was processed
+      uint64_t committed_ {0};
+      // [lo, hi] ticket ranges that failed to commit
+      std::vector<std::pair<uint64_t, uint64_t> > failed_;
+      size_t commits_ {0};
+      // protects the pending state
+      std::mutex m_;
+      // serializes commits
+      std::mutex commit_m_;
+#ifdef GMS_BUFFER_STATS
+      // fsync()/syncfs() calls of the commits
+      Buffer::Histogram fsync_ns_;
+#endif
+
+      bool failed(uint64_t ticket) const;
+      // instrumentation, cf. stats.h
+      void fsynced(int fd, uint64_t ns);
     public:
       Dir(const Dir &) =delete;
       Dir &operator=(Dir &) =delete;
@@ -43,33 +98,150 @@ namespace Memory {
       void fsync();
       void open(const std::string &path);
       void close();
+
+      void set_group_commit(bool b);
+      bool group_commit() const;
+      // commit when that many files are pending
+      void set_max_pending(size_t n);
+      // commit when the oldest pending file is that old
+      void set_max_delay(std::chrono::milliseconds d);
+      // use one syncfs() instead of fsync()ing each pending file
+      void set_syncfs(bool b);
+
+      // Takes ownership of the descriptor of a written file,
+      // returns a ticket for wait() - publish (if any) is called
+      // by the commit, before the directory is fsync'ed; discard
+      // (if any) when the file can't be synced
+      uint64_t add(int fd,
+          std::function<void()> publish = std::function<void()>(),
+          std::function<void()> discard = std::function<void()>());
+      void commit();
+      // commits if the oldest pending file exceeds the maximal delay,
+      // call it periodically, e.g. from an event loop
+      void poll();
+      // returns after the file of the ticket is committed,
+      // commits, if necessary - throws if the file's commit failed
+      void wait(uint64_t ticket);
+      // number of non-empty commits done so far
+      size_t commits() const;
+#ifdef GMS_BUFFER_STATS
+      const Buffer::Histogram &fsync_ns() const;
+#endif
   };
 
   namespace Buffer {
 
+    // Writes tokens into a file.
+    //
+    // Instead of stdio, an own (page aligned) write buffer is used.
+    // A span that doesn't fit into it is written together with the
+    // buffered prefix via one writev() call, i.e. without copying it.
+    //
+    // When opened with the DIRECT flag, the file is written with
+    // O_DIRECT, i.e. bypassing the page cache. Then, all data is
+    // staged in the buffer and written in aligned blocks. On close,
+    // the unaligned tail is written as a zero padded block and the file
+    // is truncated to its real size. If the file system doesn't support
+    // O_DIRECT, the file is written as usual (cf. direct()).
+    //
+    // For large files, space can be preallocated and writeback can
+    // be started incrementally, such that the final fsync() in close()
+    // doesn't have to flush everything at once.
+    //
+    // When opened with the ATOMIC flag, the file is created as an
+    // anonymous O_TMPFILE in the directory and only linked under its
+    // final name on close() - after its data is synced. Thus, readers
+    // never see a partially written file and a crash doesn't leave
+    // stray temporary files behind. With group commit, the link is
+    // done by the Dir commit. If the file system doesn't support
+    // O_TMPFILE, a hidden temporary file is created and renamed, instead.
+    // After a write or sync error, the file is discarded on close(),
+    // i.e. it is never published.
     class File : public Caller {
       private:
         Dir *dir_ {nullptr};
         std::string dir_path_;
         int fd {-1};
-        FILE *f {nullptr};
         std::string filename_;
         bool sync_ {true};
+        char *buf_ {nullptr};
+        size_t buf_size_ {64 * 1024};
+        size_t buf_len_ {0};
+        uint64_t ticket_ {0};
+        bool direct_ {false};
+        // file offset of the buffer start, i.e. bytes written
+        uint64_t off_ {0};
+        size_t wb_interval_ {0};
+        // end of the range whose writeback was started
+        uint64_t wb_off_ {0};
+        bool atomic_ {false};
+        bool exclusive_ {true};
+        // temporary name in case O_TMPFILE isn't supported
+        std::string tmp_name_;
+        // set on a write or sync error, then the file isn't published
+        bool failed_ {false};
+
+        void write(struct iovec *v, int n);
+        void release();
+        void allocate();
+        void opened(unsigned flags);
+        void open_atomic(int dir_fd, const std::string &name);
+        void write_direct(size_t n);
+        void close_direct();
+        void writeback();
+        void discard();
+        // instrumentation, cf. stats.h
+        void fsynced(int fd, uint64_t ns);
       public:
+        enum Flag {
+          DIRECT = 1,
+          ATOMIC = 2
+        };
+
         File(const File &) =delete;
         File &operator=(const File &) =delete;
 
         File();
-        File(const std::string &dir, const std::string &filename, bool exclusive = true);
-        File(Dir &dir, const std::string &filename, bool exclusive = true);
+        File(const std::string &dir, const std::string &filename,
+            bool exclusive = true, unsigned flags = 0);
+        File(Dir &dir, const std::string &filename, bool exclusive = true,
+            unsigned flags = 0);
         File(File &&o);
         File &operator=(File &&o);
         ~File();
-        void open(const std::string &dir, const std::string &filename, bool exclusive = true);
-        void open(const std::string &dir, const char *filename, bool exclusive = true);
-        void open(const std::string &filename, bool exclusive = true);
+        void open(const std::string &dir, const std::string &filename,
+            bool exclusive = true, unsigned flags = 0);
+        void open(const std::string &dir, const char *filename,
+            bool exclusive = true, unsigned flags = 0);
+        // opens the file relative to the Dir, cf. the Dir constructor
+        void open(const std::string &filename, bool exclusive = true,
+            unsigned flags = 0);
         void close();
         void set_sync(bool b);
+        // flushes the buffer, thus, can be called at any time
+        void set_buffer_size(size_t n);
+        // writes the buffered data
+        void flush();
+        // group commit ticket of the last close(), cf. Dir::wait()
+        uint64_t ticket() const;
+        // true if the file is written with O_DIRECT
+        bool direct() const;
+        // true if the file is published on close, cf. ATOMIC
+        bool atomic() const;
+
+        // Reserves n bytes of disk space (without changing the file
+        // size) - a no-op if the file system doesn't support it
+        void preallocate(uint64_t n);
+        // Every n bytes, start the writeback of the last n bytes, wait
+        // for the writeback of the n bytes before and drop them
+        // from the page cache - 0 disables it.
+        void set_writeback(size_t n);
+
+        // Moves exactly n bytes from a pipe into the file (after the
+        // buffered data) without copying them through user space,
+        // cf. splice(2) and Memory::Splice - not available in
+        // direct mode
+        void splice(int pipe_fd, size_t n);
 
         void clear() override;
 
@@ -79,6 +251,14 @@ namespace Memory {
     };
 
   }
+
+  // Opens an anonymous O_TMPFILE in the directory dir (relative to
+  // dir_fd) - if the file system doesn't support it, a hidden temporary
+  // file is created next to name (relative to dir_fd), instead,
+  // and its name is returned in tmp_name.
+  int open_tmpfile(int dir_fd, const char *dir, const std::string &name,
+      int flags, unsigned mode, std::string &tmp_name);
+
 }
 
 #endif
@@ -0,0 +1,129 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "handoff.h"
+
+#include <thread>
+using namespace std;
+
+namespace Memory {
+
+  Handoff::Sink::Sink(Handoff &h)
+    : h_(h)
+  {
+  }
+  void Handoff::Sink::start(const char *p)
+  {
+    Caller::start(p);
+    clear();
+  }
+  void Handoff::Sink::buffer_copy(const char *begin, const char *end,
+      bool last)
+  {
+    // always copies, since the input block is going to be reused
+    h_.current().buffer_copy(begin, end, false);
+    if (last)
+      h_.publish();
+  }
+  void Handoff::Sink::clear()
+  {
+    if (h_.cur_)
+      h_.cur_->clear();
+  }
+
+  Handoff::Handoff(size_t capacity)
+    : ring_(capacity), free_(capacity + 2), sink_(*this)
+  {
+  }
+  Handoff::~Handoff()
+  {
+  }
+
+  Buffer::Vector &Handoff::current()
+  {
+    if (!cur_) {
+      if (!free_.pop(cur_)) {
+        all_.emplace_back(new Buffer::Vector);
+        cur_ = all_.back().get();
+        allocations_.fetch_add(1, memory_order_relaxed);
+      }
+      cur_->clear();
+    }
+    return *cur_;
+  }
+
+  void Handoff::publish()
+  {
+    // empty token
+    current();
+    Entry e { cur_, Clock::now() };
+    if (!ring_.push(e)) {
+      stalls_.fetch_add(1, memory_order_relaxed);
+      do {
+        this_thread::yield();
+      } while (!ring_.push(e));
+    }
+    cur_ = nullptr;
+    tokens_.fetch_add(1, memory_order_relaxed);
+  }
+
+  Buffer::Base &Handoff::buffer()
+  {
+    return sink_;
+  }
+  void Handoff::close()
+  {
+    closed_.store(true, memory_order_release);
+  }
+
+  Buffer::Vector *Handoff::pop()
+  {
+    Entry e;
+    if (!ring_.pop(e))
+      return nullptr;
+    uint64_t d = chrono::duration_cast<chrono::nanoseconds>(
+        Clock::now() - e.t).count();
+    latency_sum_.fetch_add(d, memory_order_relaxed);
+    if (d > latency_max_.load(memory_order_relaxed))
+      latency_max_.store(d, memory_order_relaxed);
+    return e.v;
+  }
+  void Handoff::recycle(Buffer::Vector *v)
+  {
+    // when the free-list is full, the Vector is still owned by all_
+    free_.push(v);
+  }
+  bool Handoff::done() const
+  {
+    return closed_.load(memory_order_acquire) && ring_.empty();
+  }
+
+  Handoff::Stats Handoff::stats() const
+  {
+    Stats s;
+    s.tokens = tokens_.load(memory_order_relaxed);
+    s.stalls = stalls_.load(memory_order_relaxed);
+    s.allocations = allocations_.load(memory_order_relaxed);
+    s.latency_sum_ns = latency_sum_.load(memory_order_relaxed);
+    s.latency_max_ns = latency_max_.load(memory_order_relaxed);
+    return s;
+  }
+
+}
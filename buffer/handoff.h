@@ -0,0 +1,185 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_HANDOFF_H
+#define GMS_BUFFER_HANDOFF_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Memory {
+
+  // Lock-free single-producer/single-consumer ring of
+  // a power-of-2 capacity.
+  template <typename T> class Spsc_Ring {
+    private:
+      std::vector<T> v_;
+      size_t mask_;
+      // separate cache lines for the producer and the consumer index
+      alignas(64) std::atomic<size_t> head_ {0};
+      alignas(64) std::atomic<size_t> tail_ {0};
+    public:
+      Spsc_Ring(const Spsc_Ring &) =delete;
+      Spsc_Ring &operator=(const Spsc_Ring &) =delete;
+
+      Spsc_Ring(size_t capacity)
+      {
+        size_t n = 1;
+        while (n < capacity)
+          n *= 2;
+        v_.resize(n);
+        mask_ = n - 1;
+      }
+      size_t capacity() const { return v_.size(); }
+
+      // producer
+      bool push(const T &x)
+      {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) == v_.size())
+          return false;
+        v_[t & mask_] = x;
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+      }
+      // consumer
+      bool pop(T &x)
+      {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire))
+          return false;
+        x = v_[h & mask_];
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+      }
+      bool empty() const
+      {
+        return head_.load(std::memory_order_acquire)
+          == tail_.load(std::memory_order_acquire);
+      }
+  };
+
+  // Moves finished tokens from a lexer thread to a consumer
+  // thread.
+  //
+  // The lexer writes into buffer(), each finished token is published
+  // as Buffer::Vector through a lock-free ring. Since the input blocks
+  // are reused by the reader, a token is always copied into the
+  // Vector (i.e. a range_ view is committed). The consumer returns
+  // a Vector via recycle(), such that its capacity is reused and
+  // no allocation happens in the steady state.
+  //
+  // When the ring is full, the producer waits (backpressure), which
+  // is counted as stall.
+  class Handoff {
+    public:
+      struct Stats {
+        // producer
+        uint64_t tokens {0};
+        uint64_t stalls {0};
+        uint64_t allocations {0};
+        // consumer, publish to pop
+        uint64_t latency_sum_ns {0};
+        uint64_t latency_max_ns {0};
+      };
+    private:
+      typedef std::chrono::steady_clock Clock;
+      struct Entry {
+        Buffer::Vector *v;
+        Clock::time_point t;
+      };
+
+      class Sink : public Buffer::Caller {
+        private:
+          Handoff &h_;
+        public:
+          Sink(Handoff &h);
+          // drops the prefix of an abandoned token, as Vector::start()
+          void start(const char *p) override;
+          void buffer_copy(const char *begin, const char *end, bool last)
+            override;
+          void clear() override;
+      };
+
+      Spsc_Ring<Entry> ring_;
+      Spsc_Ring<Buffer::Vector*> free_;
+      // owned by the producer
+      std::vector<std::unique_ptr<Buffer::Vector> > all_;
+      Buffer::Vector *cur_ {nullptr};
+      Sink sink_;
+      std::atomic<bool> closed_ {false};
+
+      std::atomic<uint64_t> tokens_ {0};
+      std::atomic<uint64_t> stalls_ {0};
+      std::atomic<uint64_t> allocations_ {0};
+      std::atomic<uint64_t> latency_sum_ {0};
+      std::atomic<uint64_t> latency_max_ {0};
+
+      Buffer::Vector &current();
+      void publish();
+    public:
+      Handoff(const Handoff &) =delete;
+      Handoff &operator=(const Handoff &) =delete;
+
+      Handoff(size_t capacity = 1024);
+      // all Vectors have to be recycled or be unused at this point
+      ~Handoff();
+
+      // producer side
+      Buffer::Base &buffer();
+      // no more tokens
+      void close();
+
+      // consumer side - nullptr if nothing is available
+      Buffer::Vector *pop();
+      void recycle(Buffer::Vector *v);
+      // closed and everything is consumed
+      bool done() const;
+      // calls f(const Buffer::Vector &) for each token until done()
+      template <typename F> void consume(F f);
+
+      Stats stats() const;
+  };
+
+  template <typename F> void Handoff::consume(F f)
+  {
+    for (;;) {
+      Buffer::Vector *v = pop();
+      if (v) {
+        f(static_cast<const Buffer::Vector&>(*v));
+        recycle(v);
+      } else if (done()) {
+        break;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+}
+
+#endif
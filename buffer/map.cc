@@ -0,0 +1,133 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "map.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  static size_t page_size()
+  {
+    static const size_t n = sysconf(_SC_PAGESIZE);
+    return n;
+  }
+
+  Map_Reader::Map_Reader(Buffer::Base &b, int fd)
+    : b_(b), fd_(fd),
+      // leave enough address space on 32 bit systems
+      budget_(sizeof(void*) < 8 ? size_t(256) << 20 : size_t(64) << 30)
+  {
+  }
+  Map_Reader::~Map_Reader()
+  {
+    try {
+      unmap();
+    } catch (const exception &) {
+    }
+  }
+  void Map_Reader::set_budget(size_t n)
+  {
+    if (sized_)
+      throw logic_error("Map_Reader::set_budget() - already mapped");
+    budget_ = n;
+  }
+  void Map_Reader::set_window(size_t n)
+  {
+    if (sized_)
+      throw logic_error("Map_Reader::set_window() - already mapped");
+    size_t p = page_size();
+    window_ = max((n + p - 1) / p * p, p);
+  }
+  uint64_t Map_Reader::size() const
+  {
+    return size_;
+  }
+  size_t Map_Reader::windows() const
+  {
+    return windows_;
+  }
+
+  void Map_Reader::unmap()
+  {
+    if (!map_)
+      return;
+    char *m = map_;
+    map_ = nullptr;
+    posix::munmap(m, map_len_);
+  }
+
+  pair<const char*, const char*> Map_Reader::refill()
+  {
+    if (!sized_) {
+      struct stat st;
+      posix::fstat(fd_, &st);
+      size_ = st.st_size;
+      if (size_ <= budget_)
+        window_ = size_;
+      sized_ = true;
+    }
+    if (end_ >= size_) {
+      if (pe_) {
+        b_.pause(pe_);
+        pe_ = nullptr;
+      }
+      return make_pair(nullptr, nullptr);
+    }
+    uint64_t off = 0;
+    uint64_t tok_off = end_;
+    if (map_) {
+      const char *tok = b_.pending();
+      if (tok && tok >= map_ && tok <= pe_ && size_t(pe_ - tok) <= window_) {
+        tok_off = end_ - (pe_ - tok);
+      } else {
+        b_.pause(pe_);
+      }
+      off = tok_off / page_size() * page_size();
+    }
+    uint64_t len = min(end_ + window_, size_) - off;
+    char *m = static_cast<char*>(posix::mmap(nullptr, len, PROT_READ,
+          MAP_PRIVATE, fd_, off));
+    // just hints, thus errors are ignored
+    madvise(m, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(m, len, MADV_HUGEPAGE);
+#endif
+    pe_ = nullptr;
+    unmap();
+    map_ = m;
+    map_len_ = len;
+    ++windows_;
+
+    const char *p = m + (end_ - off);
+    b_.resume(m + (tok_off - off));
+    end_ = off + len;
+    pe_ = m + len;
+    return make_pair(p, pe_);
+  }
+
+}
@@ -0,0 +1,86 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_MAP_H
+#define GMS_BUFFER_MAP_H
+
+#include <buffer/buffer.h>
+#include <buffer/driver.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+namespace Memory {
+
+  // Feeds a whole file to a lexer via mmap(), such that tokens
+  // are finished zero-copy (cf. Vector::range()) - even at
+  // the end of read blocks, because there are none.
+  //
+  // Files that are larger than the address space budget are mapped in
+  // windows. The next window is mapped such that it starts with the
+  // token prefix that is still pending (cf. Base::pending()), thus,
+  // tokens stay contiguous across windows as well. A token that is
+  // longer than a window is copied via pause(), as usual.
+  //
+  // Pointers into the input are valid until the next window is mapped,
+  // i.e. until the Map_Reader is destructed when the whole file fits.
+  class Map_Reader : public Driver<Map_Reader> {
+    private:
+      Buffer::Base &b_;
+      int fd_ {-1};
+      uint64_t size_ {0};
+      bool sized_ {false};
+      size_t budget_;
+      size_t window_ {size_t(64) << 20};
+      char *map_ {nullptr};
+      size_t map_len_ {0};
+      // file offset of the end of the delivered input
+      uint64_t end_ {0};
+      const char *pe_ {nullptr};
+      size_t windows_ {0};
+
+      void unmap();
+      // maps the next window, i.e. the whole file if it fits
+      // into the budget
+      std::pair<const char*, const char*> refill();
+      friend class Driver<Map_Reader>;
+    public:
+      Map_Reader(const Map_Reader &) =delete;
+      Map_Reader &operator=(const Map_Reader &) =delete;
+
+      Map_Reader(Buffer::Base &b, int fd);
+      ~Map_Reader();
+
+      // files up to that size are mapped as a whole,
+      // call before the first next()
+      void set_budget(size_t n);
+      // window size for larger files (rounded up to the page size),
+      // call before the first next()
+      void set_window(size_t n);
+
+      uint64_t size() const;
+      // number of mappings done so far
+      size_t windows() const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "parallel.h"
+#include "batch.h"
+
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+using namespace std;
+
+namespace Memory {
+
+  Parallel::Parallel(unsigned threads)
+    : threads_(threads ? threads : max(thread::hardware_concurrency(), 1u))
+  {
+  }
+  unsigned Parallel::threads() const
+  {
+    return threads_;
+  }
+  void Parallel::set_chunk_size(size_t n)
+  {
+    if (!n)
+      throw logic_error("Parallel: chunk size must not be zero");
+    chunk_size_ = n;
+  }
+  size_t Parallel::chunk_size() const
+  {
+    return chunk_size_;
+  }
+
+  const char *Parallel::newline(const char *p, const char *pe)
+  {
+    const char *q = static_cast<const char*>(memchr(p, '\n', pe - p));
+    return q ? q + 1 : pe;
+  }
+
+  namespace {
+
+    struct Chunk {
+      const char *begin {nullptr};
+      const char *end {nullptr};
+      bool done {false};
+      Buffer::Batch batch;
+      exception_ptr error;
+    };
+
+    // chunks are handed out in input order, a chunk is
+    // only lexed when its slot is free, i.e. emitted
+    struct Window {
+      mutex m;
+      condition_variable cv;
+      vector<unique_ptr<Chunk> > slots;
+      // next chunk to lex, next chunk to emit
+      size_t next {0};
+      size_t emitted {0};
+      // end of the last chunk handed out
+      const char *p {nullptr};
+      bool stop {false};
+    };
+
+    // stops and joins the workers, also when the
+    // construction of a thread fails
+    struct Join_Guard {
+      Window &w;
+      vector<thread> &threads;
+      ~Join_Guard()
+      {
+        {
+          lock_guard<mutex> lock(w.m);
+          w.stop = true;
+        }
+        w.cv.notify_all();
+        for (auto &t : threads)
+          if (t.joinable())
+            t.join();
+      }
+    };
+
+  }
+
+  void Parallel::run(const char *begin, const char *end,
+      Sync sync, Lex lex, Emit emit)
+  {
+    if (begin == end)
+      return;
+    size_t n = end - begin;
+    // smaller inputs are still split between all threads
+    size_t size = max(size_t(1), min(chunk_size_, n / threads_));
+
+    Window w;
+    w.p = begin;
+    for (unsigned i = 0; i < 2 * threads_; ++i)
+      w.slots.emplace_back(new Chunk);
+
+    auto work = [&w, &sync, &lex, end, size]() {
+      for (;;) {
+        unique_lock<mutex> lock(w.m);
+        w.cv.wait(lock, [&w, end]() { return w.stop || w.p == end
+            || w.next < w.emitted + w.slots.size(); });
+        if (w.stop || w.p == end)
+          return;
+        Chunk &c = *w.slots[w.next % w.slots.size()];
+        ++w.next;
+        c.begin = w.p;
+        c.end = size_t(end - w.p) > size
+          ? max(w.p, sync(w.p + size, end)) : end;
+        if (c.end == c.begin)
+          c.end = end;
+        w.p = c.end;
+        bool is_last = c.end == end;
+        lock.unlock();
+        try {
+          lex(c.batch, c.begin, c.end);
+          if (c.batch.pending()) {
+            if (!is_last)
+              throw logic_error("Parallel: token crosses a chunk boundary,"
+                  " check the sync function");
+            c.batch.finish(c.end);
+          }
+        } catch (...) {
+          c.error = current_exception();
+        }
+        lock.lock();
+        c.done = true;
+        w.cv.notify_all();
+      }
+    };
+
+    vector<thread> threads;
+    Join_Guard guard { w, threads };
+    for (unsigned i = 0; i < threads_; ++i)
+      threads.emplace_back(work);
+
+    // the calling thread emits the chunks in order
+    for (size_t i = 0; ; ++i) {
+      Chunk *c = nullptr;
+      {
+        unique_lock<mutex> lock(w.m);
+        w.cv.wait(lock, [&w, i, end]() {
+            return (i < w.next && w.slots[i % w.slots.size()]->done)
+              || (w.p == end && i == w.next); });
+        if (i == w.next)
+          break;
+        c = w.slots[i % w.slots.size()].get();
+      }
+      if (c->error)
+        rethrow_exception(c->error);
+      for (size_t k = 0; k < c->batch.size(); ++k) {
+        auto r = c->batch[k];
+        emit(r.first, r.second);
+      }
+      c->batch.clear();
+      {
+        lock_guard<mutex> lock(w.m);
+        c->done = false;
+        w.emitted = i + 1;
+      }
+      w.cv.notify_all();
+    }
+  }
+
+}
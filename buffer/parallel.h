@@ -0,0 +1,83 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_PARALLEL_H
+#define GMS_BUFFER_PARALLEL_H
+
+#include <buffer/buffer.h>
+
+#include <functional>
+
+namespace Memory {
+
+  // Lexes a large contiguous input (e.g. a file mapped via
+  // Map_Reader) with one lexer per chunk in parallel and emits
+  // the tokens in input order.
+  //
+  // Contract: a chunk has to start where the lexer can start in its
+  // initial state. The input is split into equally sized parts and
+  // each split point is moved forward to the next such position, as
+  // returned by the sync function (e.g. the position after the next
+  // newline, for newline-delimited records). Thus, each chunk extends
+  // to the next sync point and a token never crosses a chunk
+  // boundary - a lexer that leaves a token open at the end of an inner
+  // chunk violates the contract (logic_error). An open token at the
+  // end of the input is finished there.
+  //
+  // The tokens of a chunk are collected in a Buffer::Batch, i.e.
+  // they are referenced, unless the lexer uses stop()/cont() - then
+  // they are copied. Emitting the tokens of a chunk overlaps with
+  // lexing the following chunks.
+  //
+  // A chunk is at most (about) chunk_size() bytes large and at most
+  // 2 * threads() chunks are in flight, i.e. lexed or waiting to be
+  // emitted. Thus, the memory used for the token tables is bounded,
+  // even for a multi-GB input.
+  class Parallel {
+    public:
+      // first position in [p, pe] where the lexer can start, pe if
+      // there is none
+      typedef std::function<const char *(const char *p, const char *pe)>
+        Sync;
+      // lexes [p, pe) from the initial state, calling
+      // start()/finish() etc. on b
+      typedef std::function<void(Buffer::Base &b,
+          const char *p, const char *pe)> Lex;
+      typedef std::function<void(const char *begin, const char *end)> Emit;
+    private:
+      unsigned threads_;
+      size_t chunk_size_ {8 * 1024 * 1024};
+    public:
+      // 0 threads means one per core
+      Parallel(unsigned threads = 0);
+      unsigned threads() const;
+      void set_chunk_size(size_t n);
+      size_t chunk_size() const;
+
+      void run(const char *begin, const char *end,
+          Sync sync, Lex lex, Emit emit);
+
+      // sync function for newline-delimited records
+      static const char *newline(const char *p, const char *pe);
+  };
+
+}
+
+#endif
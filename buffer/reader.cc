@@ -0,0 +1,183 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "reader.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  static const size_t page_size = 4096;
+  static const size_t huge_page_size = 2 * 1024 * 1024;
+  // number of blocks after which the span rate is evaluated
+  static const size_t window = 64;
+
+  Reader::Reader(Buffer::Base &b, int fd, size_t block)
+    : b_(b), fd_(fd), block_(block), max_block_(max(block, size_t(16) << 20))
+  {
+    if (!block)
+      throw logic_error("Reader: block size must not be zero");
+  }
+  Reader::~Reader()
+  {
+    release();
+  }
+  void Reader::set_max_block(size_t n)
+  {
+    if (buf_)
+      throw logic_error("Reader::set_max_block() - already reading");
+    max_block_ = max(n, block_);
+  }
+  void Reader::set_huge_pages(bool b)
+  {
+    if (buf_)
+      throw logic_error("Reader::set_huge_pages() - already reading");
+    huge_ = b;
+  }
+  size_t Reader::block_size() const
+  {
+    return block_;
+  }
+  size_t Reader::blocks() const
+  {
+    return blocks_;
+  }
+  size_t Reader::spans() const
+  {
+    return spans_;
+  }
+
+  size_t Reader::capacity(size_t block) const
+  {
+    // room for a kept token prefix of up to one block
+    // and the next block
+    size_t n = 2 * block;
+    if (huge_)
+      n = (n + huge_page_size - 1) / huge_page_size * huge_page_size;
+    return n;
+  }
+  void Reader::allocate(size_t block, const char *keep_begin, size_t keep)
+  {
+    size_t n = capacity(block);
+    char *p = nullptr;
+    if (huge_) {
+      p = static_cast<char*>(posix::mmap(nullptr, n, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#ifdef MADV_HUGEPAGE
+      // just a hint, thus errors are ignored
+      madvise(p, n, MADV_HUGEPAGE);
+#endif
+    } else {
+      void *v = nullptr;
+      if (posix_memalign(&v, page_size, n))
+        throw bad_alloc();
+      p = static_cast<char*>(v);
+    }
+    if (keep)
+      memcpy(p, keep_begin, keep);
+    release();
+    buf_ = p;
+    capacity_ = n;
+    block_ = block;
+  }
+  void Reader::release()
+  {
+    if (!buf_)
+      return;
+    if (huge_)
+      posix::munmap(buf_, capacity_);
+    else
+      free(buf_);
+    buf_ = nullptr;
+    capacity_ = 0;
+  }
+
+  size_t Reader::adapt(size_t keep)
+  {
+    bool grow = keep > block_ / 2;
+    if (window_blocks_ >= window) {
+      // more than a quarter of the blocks end inside a token
+      if (window_spans_ * 4 > window_blocks_)
+        grow = true;
+      window_blocks_ = 0;
+      window_spans_ = 0;
+    }
+    if (!grow || block_ >= max_block_)
+      return block_;
+    return min(2 * block_, max_block_);
+  }
+
+  pair<const char*, const char*> Reader::refill()
+  {
+    if (!buf_)
+      allocate(block_, nullptr, 0);
+    size_t keep = 0;
+    if (pe_) {
+      ++blocks_;
+      ++window_blocks_;
+      const char *tok = b_.pending();
+      if (tok && tok >= buf_ && tok <= pe_) {
+        keep = pe_ - tok;
+        ++spans_;
+        ++window_spans_;
+        size_t block = adapt(keep);
+        // decide between copy and relocation while tok still
+        // points into the current buffer
+        if (keep + block > capacity(block)) {
+          // token doesn't fit - fall back to copying it
+          b_.pause(pe_);
+          keep = 0;
+          if (block != block_)
+            allocate(block, nullptr, 0);
+        } else if (block != block_) {
+          allocate(block, tok, keep);
+        } else if (tok != buf_) {
+          memmove(buf_, tok, keep);
+        }
+      } else {
+        b_.pause(pe_);
+        size_t block = adapt(0);
+        if (block != block_)
+          allocate(block, nullptr, 0);
+      }
+      pe_ = nullptr;
+    }
+    size_t n = posix::read(fd_, buf_ + keep, block_);
+    if (!n) {
+      if (keep) {
+        b_.resume(buf_);
+        b_.pause(buf_ + keep);
+      }
+      return make_pair(nullptr, nullptr);
+    }
+    b_.resume(buf_);
+    pe_ = buf_ + keep + n;
+    return make_pair(buf_ + keep, pe_);
+  }
+
+}
@@ -0,0 +1,93 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_READER_H
+#define GMS_BUFFER_READER_H
+
+#include <buffer/buffer.h>
+#include <buffer/driver.h>
+
+#include <stddef.h>
+#include <utility>
+
+namespace Memory {
+
+  // Owns the read loop: reads blocks from a file descriptor into
+  // an aligned buffer and feeds them to a lexer.
+  //
+  // When a block ends inside a token, the not yet copied token
+  // prefix (cf. Base::pending()) is moved to the front of the
+  // read buffer and the next block is read behind it - as
+  // flex/re2c do it. Thus, a token that spans blocks usually
+  // stays contiguous and a Buffer::Vector finishes it via
+  // its zero-copy range. Only when a token doesn't fit
+  // into the buffer (of maximal size), the usual
+  // Base::pause() copy is done.
+  //
+  // The block size is doubled (up to the maximum) when many blocks end
+  // inside a token or when a token occupies more than half a block.
+  //
+  // Pointers into the input (e.g. Vector::range()) are valid
+  // until the next block is read.
+  class Reader : public Driver<Reader> {
+    private:
+      Buffer::Base &b_;
+      int fd_ {-1};
+      char *buf_ {nullptr};
+      size_t capacity_ {0};
+      size_t block_;
+      size_t max_block_;
+      bool huge_ {false};
+      const char *pe_ {nullptr};
+      size_t blocks_ {0};
+      size_t spans_ {0};
+      size_t window_blocks_ {0};
+      size_t window_spans_ {0};
+
+      size_t capacity(size_t block) const;
+      void allocate(size_t block, const char *keep_begin, size_t keep);
+      void release();
+      // returns the size of the next block
+      size_t adapt(size_t keep);
+      std::pair<const char*, const char*> refill();
+      friend class Driver<Reader>;
+    public:
+      Reader(const Reader &) =delete;
+      Reader &operator=(const Reader &) =delete;
+
+      Reader(Buffer::Base &b, int fd, size_t block = 64 * 1024);
+      ~Reader();
+
+      // call before the first next()
+      void set_max_block(size_t n);
+      // back the buffer with transparent huge pages,
+      // call before the first next()
+      void set_huge_pages(bool b);
+
+      size_t block_size() const;
+      // number of blocks read
+      size_t blocks() const;
+      // number of blocks that ended inside a token
+      size_t spans() const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "ring.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+namespace Memory {
+
+  Ring_Reader::Ring_Reader(Buffer::Base &b, int fd, size_t size)
+    : b_(b), fd_(fd)
+  {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_ = max((size + page - 1) / page * page, page);
+    block_ = max(size_ / 4, size_t(1));
+
+    mem_fd_ = memfd_create("libbuffer-ring", MFD_CLOEXEC);
+    if (mem_fd_ == -1)
+      throw runtime_error(string("memfd_create: ") + strerror(errno));
+    try {
+      posix::ftruncate(mem_fd_, size_);
+      // reserve the address space for both mappings
+      base_ = static_cast<char*>(posix::mmap(nullptr, 2 * size_, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      posix::mmap(base_, size_, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_FIXED, mem_fd_, 0);
+      posix::mmap(base_ + size_, size_, PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_FIXED, mem_fd_, 0);
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+  Ring_Reader::~Ring_Reader()
+  {
+    try {
+      release();
+    } catch (const exception &) {
+    }
+  }
+  void Ring_Reader::release()
+  {
+    if (base_) {
+      char *p = base_;
+      base_ = nullptr;
+      posix::munmap(p, 2 * size_);
+    }
+    if (mem_fd_ != -1) {
+      int fd = mem_fd_;
+      mem_fd_ = -1;
+      posix::close(fd);
+    }
+  }
+  void Ring_Reader::set_block(size_t n)
+  {
+    block_ = min(max(n, size_t(1)), size_);
+  }
+  size_t Ring_Reader::size() const
+  {
+    return size_;
+  }
+  size_t Ring_Reader::copies() const
+  {
+    return copies_;
+  }
+
+  pair<const char*, const char*> Ring_Reader::refill()
+  {
+    size_t keep = 0;
+    if (pe_) {
+      const char *tok = b_.pending();
+      if (tok && tok >= base_ && tok <= pe_) {
+        keep = pe_ - tok;
+        if (keep + block_ > size_) {
+          // the read would overrun the token start
+          b_.pause(pe_);
+          ++copies_;
+          keep = 0;
+        }
+      } else {
+        b_.pause(pe_);
+      }
+      pe_ = nullptr;
+    }
+    // the token start is located in the first mapping, thus, the
+    // token prefix and the next block are contiguous (possibly
+    // extending into the second mapping)
+    char *t = base_ + (head_ - keep) % size_;
+    char *p = t + keep;
+    size_t n = posix::read(fd_, p, block_);
+    if (!n) {
+      if (keep) {
+        b_.resume(t);
+        b_.pause(p);
+      }
+      return make_pair(nullptr, nullptr);
+    }
+    b_.resume(t);
+    head_ += n;
+    pe_ = p + n;
+    return make_pair(p, pe_);
+  }
+
+}
@@ -0,0 +1,81 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_RING_H
+#define GMS_BUFFER_RING_H
+
+#include <buffer/buffer.h>
+#include <buffer/driver.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+namespace Memory {
+
+  // Reads from a file descriptor (e.g. a socket) into a ring
+  // buffer that is mapped twice, back to back. Thus, input that
+  // wraps around the end of the ring is contiguous in virtual memory.
+  //
+  // As long as the start of an active token (cf. Base::pending())
+  // isn't overwritten, the next block is read behind it and resume()
+  // is called with the token start - no partial token is copied
+  // and a Buffer::Vector finishes the token via its zero-copy
+  // range. Only when a token would be overrun by the next read,
+  // the usual pause() copy is done.
+  //
+  // Pointers into the input are valid until the next block is read.
+  class Ring_Reader : public Driver<Ring_Reader> {
+    private:
+      Buffer::Base &b_;
+      int fd_ {-1};
+      int mem_fd_ {-1};
+      char *base_ {nullptr};
+      size_t size_;
+      size_t block_;
+      // stream offset of the end of the delivered input
+      uint64_t head_ {0};
+      const char *pe_ {nullptr};
+      size_t copies_ {0};
+
+      void release();
+      std::pair<const char*, const char*> refill();
+      friend class Driver<Ring_Reader>;
+    public:
+      Ring_Reader(const Ring_Reader &) =delete;
+      Ring_Reader &operator=(const Ring_Reader &) =delete;
+
+      // size is rounded up to the page size, a read is at most
+      // a quarter of the ring, by default
+      Ring_Reader(Buffer::Base &b, int fd, size_t size = 1024 * 1024);
+      ~Ring_Reader();
+
+      // maximal size of a read, at most the ring size
+      void set_block(size_t n);
+
+      size_t size() const;
+      // number of tokens that had to be copied because they
+      // would have been overrun
+      size_t copies() const;
+  };
+
+}
+
+#endif
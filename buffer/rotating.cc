@@ -0,0 +1,242 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "rotating.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+using namespace std;
+
+namespace Memory {
+
+  namespace Buffer {
+
+    struct Rotating_File::Worker {
+      Dir &dir;
+      const string &prefix;
+      mutex m;
+      condition_variable cv;
+      bool sync {true};
+      File next;
+      string next_name;
+      bool ready {false};
+      uint64_t seq;
+      deque<File> closing;
+      bool stop {false};
+      exception_ptr error;
+      thread t;
+
+      Worker(Dir &dir, const string &prefix, uint64_t seq);
+      ~Worker();
+      void run();
+    };
+
+    Rotating_File::Worker::Worker(Dir &dir, const string &prefix,
+        uint64_t seq)
+      : dir(dir), prefix(prefix), seq(seq)
+    {
+      t = thread(&Worker::run, this);
+    }
+    Rotating_File::Worker::~Worker()
+    {
+      {
+        lock_guard<mutex> l(m);
+        stop = true;
+      }
+      cv.notify_all();
+      if (t.joinable())
+        t.join();
+    }
+    void Rotating_File::Worker::run()
+    {
+      unique_lock<mutex> l(m);
+      for (;;) {
+        cv.wait(l, [this]() {
+            return stop || !closing.empty() || (!ready && !error); });
+        // the next file is needed first
+        if (!ready && !error && !stop) {
+          string name(filename(prefix, seq));
+          bool s = sync;
+          l.unlock();
+          try {
+            File f(dir, name);
+            f.set_sync(s);
+            l.lock();
+            next = std::move(f);
+            next_name = name;
+            ready = true;
+            ++seq;
+          } catch (...) {
+            if (!l.owns_lock())
+              l.lock();
+            error = current_exception();
+          }
+          cv.notify_all();
+          continue;
+        }
+        if (!closing.empty()) {
+          File f(std::move(closing.front()));
+          closing.pop_front();
+          l.unlock();
+          try {
+            f.close();
+            l.lock();
+          } catch (...) {
+            l.lock();
+            error = current_exception();
+          }
+          cv.notify_all();
+          continue;
+        }
+        if (stop)
+          return;
+      }
+    }
+
+    Rotating_File::Rotating_File(Dir &dir, const std::string &prefix,
+        uint64_t max_bytes, std::chrono::milliseconds max_age)
+      : dir_(dir), prefix_(prefix), max_bytes_(max_bytes), max_age_(max_age),
+        cur_name_(filename(prefix, 0)), cur_start_(Clock::now())
+    {
+      cur_ = File(dir, cur_name_);
+      w_.reset(new Worker(dir_, prefix_, 1));
+    }
+    Rotating_File::~Rotating_File()
+    {
+      try {
+        close();
+      } catch (const exception &) {
+      }
+    }
+
+    std::string Rotating_File::filename(const std::string &prefix,
+        uint64_t i)
+    {
+      char b[24];
+      snprintf(b, sizeof b, ".%06llu", static_cast<unsigned long long>(i));
+      return prefix + b;
+    }
+
+    void Rotating_File::set_sync(bool b)
+    {
+      cur_.set_sync(b);
+      if (w_) {
+        lock_guard<mutex> l(w_->m);
+        w_->sync = b;
+        if (w_->ready)
+          w_->next.set_sync(b);
+      }
+    }
+    const std::string &Rotating_File::filename() const
+    {
+      return cur_name_;
+    }
+    uint64_t Rotating_File::files() const
+    {
+      return files_;
+    }
+    uint64_t Rotating_File::stalls() const
+    {
+      return stalls_;
+    }
+
+    void Rotating_File::rotate()
+    {
+      Worker &w = *w_;
+      {
+        unique_lock<mutex> l(w.m);
+        if (!w.ready && !w.error) {
+          ++stalls_;
+          w.cv.wait(l, [&w]() { return w.ready || w.error; });
+        }
+        if (w.error)
+          rethrow_exception(w.error);
+        w.closing.push_back(std::move(cur_));
+        cur_ = std::move(w.next);
+        cur_name_ = std::move(w.next_name);
+        w.ready = false;
+      }
+      w.cv.notify_all();
+      cur_bytes_ = 0;
+      cur_start_ = Clock::now();
+      ++files_;
+    }
+
+    void Rotating_File::close()
+    {
+      if (!w_)
+        return;
+      exception_ptr error;
+      {
+        Worker &w = *w_;
+        {
+          lock_guard<mutex> l(w.m);
+          w.stop = true;
+        }
+        // the worker closes the pending files first
+        w.cv.notify_all();
+        w.t.join();
+        error = w.error;
+        if (w.ready) {
+          w.next.set_sync(false);
+          w.next.close();
+          if (unlinkat(dir_.fd(), w.next_name.c_str(), 0) == -1 && !error)
+            error = make_exception_ptr(runtime_error(string("unlinkat: ")
+                  + strerror(errno)));
+        }
+      }
+      w_.reset();
+      cur_.close();
+      if (error)
+        rethrow_exception(error);
+    }
+
+    void Rotating_File::clear()
+    {
+    }
+
+    void Rotating_File::buffer_copy(const char *begin, const char *end,
+        bool last)
+    {
+      if (!w_)
+        throw logic_error("Rotating_File::buffer_copy() - file closed");
+      cur_.buffer_copy(begin, end, last);
+      cur_bytes_ += end - begin;
+    }
+    void Rotating_File::start(const char *p)
+    {
+      // i.e. switched lazily, such that there is no empty last file
+      if (cur_bytes_ && ((max_bytes_ && cur_bytes_ >= max_bytes_)
+          || (max_age_.count() && Clock::now() - cur_start_ >= max_age_)))
+        rotate();
+      Caller::start(p);
+    }
+
+  }
+}
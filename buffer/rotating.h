@@ -0,0 +1,101 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_ROTATING_H
+#define GMS_BUFFER_ROTATING_H
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Writes tokens into a sequence of files PREFIX.000000,
+    // PREFIX.000001, ... in a Dir and starts the next file when the
+    // current one reaches max_bytes or is older than max_age (0:
+    // unlimited). The switch happens when the next token is started,
+    // i.e. a token is never split between two files.
+    //
+    // A worker thread pre-creates the next file (via openat() on the
+    // Dir) and closes (and syncs) the previous files, such that
+    // a switch is just a move on the lexer thread. When the next file
+    // isn't ready yet, the switch waits for it (counted as stall).
+    //
+    // On close(), the pre-created file is removed again.
+    class Rotating_File : public Caller {
+      private:
+        typedef std::chrono::steady_clock Clock;
+        struct Worker;
+        Dir &dir_;
+        std::string prefix_;
+        uint64_t max_bytes_;
+        std::chrono::milliseconds max_age_;
+        File cur_;
+        std::string cur_name_;
+        uint64_t cur_bytes_ {0};
+        Clock::time_point cur_start_;
+        uint64_t files_ {1};
+        uint64_t stalls_ {0};
+        // last member, such that the thread is stopped first
+        std::unique_ptr<Worker> w_;
+
+        void rotate();
+      public:
+        Rotating_File(const Rotating_File &) =delete;
+        Rotating_File &operator=(const Rotating_File &) =delete;
+
+        Rotating_File(Dir &dir, const std::string &prefix,
+            uint64_t max_bytes,
+            std::chrono::milliseconds max_age = std::chrono::milliseconds(0));
+        ~Rotating_File();
+
+        // for the following files, i.e. applied to the current one
+        // when it is closed
+        void set_sync(bool b);
+        // closes the current file, waits for the worker
+        void close();
+
+        // name of the file that is currently written
+        const std::string &filename() const;
+        // number of files started so far
+        uint64_t files() const;
+        // switches that had to wait for the next file
+        uint64_t stalls() const;
+        static std::string filename(const std::string &prefix, uint64_t i);
+
+        void clear() override;
+
+        void start(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override;
+    };
+
+  }
+}
+
+#endif
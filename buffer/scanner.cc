@@ -0,0 +1,146 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "scanner.h"
+
+#include <string.h>
+#include <stdexcept>
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #define GMS_BUFFER_X86
+  #include <immintrin.h>
+#endif
+
+namespace Memory {
+
+  static const char *find_scalar(const char (*)[32], unsigned,
+      const bool *table, const char *p, const char *pe)
+  {
+    for (; p != pe; ++p)
+      if (table[static_cast<unsigned char>(*p)])
+        return p;
+    return pe;
+  }
+
+#ifdef GMS_BUFFER_X86
+
+  __attribute__((target("sse2")))
+  static const char *find_sse2(const char (*splat)[32], unsigned n,
+      const bool *table, const char *p, const char *pe)
+  {
+    const __m128i *d = reinterpret_cast<const __m128i*>(splat);
+    for (; pe - p >= 16; p += 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      // i.e. the first 16 bytes of each splat row
+      __m128i m = _mm_cmpeq_epi8(x, _mm_loadu_si128(d));
+      for (unsigned i = 1; i < n; ++i)
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_loadu_si128(d + 2 * i)));
+      unsigned mask = _mm_movemask_epi8(m);
+      if (mask)
+        return p + __builtin_ctz(mask);
+    }
+    return find_scalar(splat, n, table, p, pe);
+  }
+
+  __attribute__((target("avx2")))
+  static const char *find_avx2(const char (*splat)[32], unsigned n,
+      const bool *table, const char *p, const char *pe)
+  {
+    const __m256i *d = reinterpret_cast<const __m256i*>(splat);
+    for (; pe - p >= 32; p += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      __m256i m = _mm256_cmpeq_epi8(x, _mm256_loadu_si256(d));
+      for (unsigned i = 1; i < n; ++i)
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x,
+              _mm256_loadu_si256(d + i)));
+      unsigned mask = _mm256_movemask_epi8(m);
+      if (mask)
+        return p + __builtin_ctz(mask);
+    }
+    return find_sse2(splat, n, table, p, pe);
+  }
+
+#endif
+
+  static bool supported(Scanner::Kernel k)
+  {
+#ifdef GMS_BUFFER_X86
+    // the CPU model might not be initialized yet, e.g. when a
+    // Scanner is constructed during static initialization
+    __builtin_cpu_init();
+#endif
+    switch (k) {
+      case Scanner::AUTO:
+      case Scanner::SCALAR:
+        return true;
+#ifdef GMS_BUFFER_X86
+      case Scanner::SSE2:
+        return __builtin_cpu_supports("sse2");
+      case Scanner::AVX2:
+        return __builtin_cpu_supports("avx2");
+#else
+      default:
+        return false;
+#endif
+    }
+    return false;
+  }
+
+  Scanner::Scanner(const std::string &delimiters, Kernel k)
+  {
+    if (delimiters.empty()
+        || delimiters.size() > sizeof splat_ / sizeof splat_[0])
+      throw logic_error("Scanner: expect 1 to 16 delimiters");
+    memset(table_, 0, sizeof table_);
+    for (char c : delimiters) {
+      if (table_[static_cast<unsigned char>(c)])
+        continue;
+      table_[static_cast<unsigned char>(c)] = true;
+      memset(splat_[n_++], c, sizeof splat_[0]);
+    }
+    if (!supported(k))
+      throw runtime_error("Scanner: kernel not supported by this CPU");
+    if (k == AUTO) {
+      k = SCALAR;
+      if (supported(SSE2))
+        k = SSE2;
+      if (supported(AVX2))
+        k = AVX2;
+    }
+    kernel_ = k;
+    switch (k) {
+#ifdef GMS_BUFFER_X86
+      case SSE2: find_ = find_sse2; break;
+      case AVX2: find_ = find_avx2; break;
+#endif
+      default: find_ = find_scalar; break;
+    }
+  }
+  Scanner::Kernel Scanner::kernel() const
+  {
+    return kernel_;
+  }
+  void Scanner::reset()
+  {
+    active_ = false;
+  }
+
+}
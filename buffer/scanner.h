@@ -0,0 +1,98 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_SCANNER_H
+#define GMS_BUFFER_SCANNER_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <string>
+
+namespace Memory {
+
+  // Tokenizer for delimiter-based formats (CSV, line protocols,
+  // key=value, ...).
+  //
+  // It searches for the next delimiter 16 (SSE2) or 32 (AVX2) bytes
+  // at a time - the kernel is selected at runtime - and calls
+  // start()/finish() on a buffer. Each delimiter finishes a token,
+  // i.e. the input is a sequence of (possibly empty) tokens
+  // separated by delimiters. Use it inside a Resume block, as a lexer.
+  class Scanner {
+    public:
+      enum Kernel {
+        AUTO,
+        SCALAR,
+        SSE2,
+        AVX2
+      };
+      // splat: each delimiter repeated 32 times, i.e. the
+      // vectors the kernels compare with
+      typedef const char *(*Find)(const char (*splat)[32], unsigned n,
+          const bool *table, const char *p, const char *pe);
+    private:
+      // at most 16 delimiters, broadcast once
+      char splat_[16][32];
+      unsigned n_ {0};
+      bool table_[256];
+      Kernel kernel_ {SCALAR};
+      Find find_ {nullptr};
+      bool active_ {false};
+    public:
+      // throws if the kernel isn't supported by the CPU
+      Scanner(const std::string &delimiters, Kernel k = AUTO);
+
+      Kernel kernel() const;
+
+      // first delimiter in [p, pe) or pe
+      const char *find(const char *p, const char *pe) const
+      {
+        return find_(splat_, n_, table_, p, pe);
+      }
+
+      // Calls f(delimiter) after each token is finished in b, i.e. when
+      // the token can be consumed from b. At the end of the input,
+      // finish the last token with b.finish() (if it is
+      // non-empty and should be consumed).
+      template <typename B, typename F>
+        void scan(B &b, const char *p, const char *pe, F f)
+        {
+          if (!active_) {
+            b.start(p);
+            active_ = true;
+          }
+          for (;;) {
+            const char *q = find(p, pe);
+            if (q == pe)
+              return;
+            b.finish(q);
+            f(*q);
+            p = q + 1;
+            b.start(p);
+          }
+        }
+      // for a new input
+      void reset();
+  };
+
+}
+
+#endif
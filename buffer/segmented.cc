@@ -0,0 +1,212 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "segmented.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  Block_Pool::Block_Pool(size_t block_size)
+    : block_size_(block_size)
+  {
+    if (!block_size)
+      throw logic_error("Block_Pool: block size must not be zero");
+  }
+  std::shared_ptr<char> Block_Pool::get()
+  {
+    for (auto &b : blocks_)
+      if (b.use_count() == 1)
+        return b;
+    blocks_.emplace_back(new char[block_size_], default_delete<char[]>());
+    return blocks_.back();
+  }
+  size_t Block_Pool::block_size() const
+  {
+    return block_size_;
+  }
+  size_t Block_Pool::size() const
+  {
+    return blocks_.size();
+  }
+
+  namespace Buffer {
+
+    Segmented::Segmented()
+    {
+    }
+    Segmented::Segmented(Segmented &&o)
+      : segs_(std::move(o.segs_)), leases_(std::move(o.leases_)),
+        lease_(std::move(o.lease_)), arena_(std::move(o.arena_)),
+        chunk_(o.chunk_), used_(o.used_), v_(std::move(o.v_)),
+        size_(o.size_)
+    {
+      o.arena_.clear();
+      o.clear();
+    }
+    Segmented &Segmented::operator=(Segmented &&o)
+    {
+      segs_ = std::move(o.segs_);
+      leases_ = std::move(o.leases_);
+      lease_ = std::move(o.lease_);
+      arena_ = std::move(o.arena_);
+      o.arena_.clear();
+      chunk_ = o.chunk_;
+      used_ = o.used_;
+      v_ = std::move(o.v_);
+      size_ = o.size_;
+      o.clear();
+      return *this;
+    }
+
+    void Segmented::set_lease(std::shared_ptr<const void> lease)
+    {
+      lease_ = std::move(lease);
+    }
+    void Segmented::start(const char *p)
+    {
+      Caller::start(p);
+      clear();
+    }
+    void Segmented::pause(const char *p)
+    {
+      Caller::pause(p);
+      lease_.reset();
+    }
+    char *Segmented::allocate(size_t n)
+    {
+      for (; chunk_ < arena_.size(); ++chunk_, used_ = 0) {
+        Chunk &c = arena_[chunk_];
+        if (c.size - used_ >= n) {
+          char *r = c.p.get() + used_;
+          used_ += n;
+          return r;
+        }
+      }
+      size_t k = max(n, arena_.empty() ? size_t(4096)
+          : 2 * arena_.back().size);
+      arena_.push_back(Chunk { unique_ptr<char[]>(new char[k]), k });
+      chunk_ = arena_.size() - 1;
+      used_ = n;
+      return arena_.back().p.get();
+    }
+    void Segmented::buffer_copy(const char *begin, const char *end,
+        bool last)
+    {
+      assert(begin<=end);
+      if (begin == end)
+        return;
+      size_t n = end - begin;
+      const char *p = begin;
+      if (!lease_ && !last) {
+        char *q = allocate(n);
+        memcpy(q, begin, n);
+        // adjacent in the arena
+        if (!segs_.empty() && static_cast<char*>(segs_.back().iov_base)
+            + segs_.back().iov_len == q) {
+          segs_.back().iov_len += n;
+          size_ += n;
+          return;
+        }
+        p = q;
+      }
+      segs_.push_back(iovec { const_cast<char*>(p), n });
+      if (lease_)
+        leases_.push_back(lease_);
+      size_ += n;
+    }
+    void Segmented::clear()
+    {
+      segs_.clear();
+      leases_.clear();
+      chunk_ = 0;
+      used_ = 0;
+      v_.clear();
+      size_ = 0;
+    }
+
+    const struct iovec *Segmented::iov() const
+    {
+      return segs_.data();
+    }
+    int Segmented::iovcnt() const
+    {
+      return segs_.size();
+    }
+    size_t Segmented::size() const
+    {
+      return size_;
+    }
+    bool Segmented::empty() const
+    {
+      return !size_;
+    }
+    std::pair<const char*, const char*> Segmented::contiguous()
+    {
+      if (segs_.empty())
+        return make_pair(nullptr, nullptr);
+      if (segs_.size() == 1) {
+        const char *p = static_cast<const char*>(segs_.front().iov_base);
+        return make_pair(p, p + segs_.front().iov_len);
+      }
+      if (v_.empty()) {
+        v_.reserve(size_);
+        for (auto &s : segs_) {
+          const char *p = static_cast<const char*>(s.iov_base);
+          v_.insert(v_.end(), p, p + s.iov_len);
+        }
+      }
+      return make_pair(v_.data(), v_.data() + v_.size());
+    }
+    void Segmented::write(int fd)
+    {
+      for (size_t i = 0; i < segs_.size(); ) {
+        size_t k = min(segs_.size() - i, size_t(IOV_MAX));
+        out_.assign(segs_.begin() + i, segs_.begin() + i + k);
+        i += k;
+        struct iovec *v = out_.data();
+        int n = k;
+        while (n) {
+          ssize_t r = ::writev(fd, v, n);
+          if (r == -1) {
+            if (errno == EINTR)
+              continue;
+            throw runtime_error(string("writev: ") + strerror(errno));
+          }
+          size_t m = r;
+          // skip what was written, partial writes are possible
+          for (; n && m >= v->iov_len; ++v, --n)
+            m -= v->iov_len;
+          if (n) {
+            v->iov_base = static_cast<char*>(v->iov_base) + m;
+            v->iov_len -= m;
+          }
+        }
+      }
+    }
+
+  }
+}
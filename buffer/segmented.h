@@ -0,0 +1,120 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_SEGMENTED_H
+#define GMS_BUFFER_SEGMENTED_H
+
+#include <buffer/buffer.h>
+
+#include <sys/uio.h>
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  // Hands out read blocks of a fixed size. A block is reused when
+  // the pool holds the only reference to it, i.e. when all
+  // leases (e.g. of a Buffer::Segmented) are gone.
+  class Block_Pool {
+    private:
+      size_t block_size_;
+      std::vector<std::shared_ptr<char> > blocks_;
+    public:
+      Block_Pool(size_t block_size);
+      std::shared_ptr<char> get();
+      size_t block_size() const;
+      // number of allocated blocks
+      size_t size() const;
+  };
+
+  namespace Buffer {
+
+    // Records a token as list of segments (an iovec array that can
+    // be passed to writev()/sendmsg()) instead of copying it.
+    //
+    // The reader has to announce a lease on each input block via
+    // set_lease() before it is lexed - segments in that block keep
+    // it alive. A lease only covers one block, i.e. it is dropped on
+    // pause(). Without a lease, the parts of a spanning token are
+    // copied into an arena that is reused for the next tokens (thus,
+    // in the steady state, nothing is allocated). As with Vector, the
+    // last segment is valid at least until the next block is read.
+    //
+    // A contiguous copy is only made when contiguous() is called for
+    // a token that consists of several segments.
+    class Segmented : public Caller {
+      private:
+        struct Chunk {
+          std::unique_ptr<char[]> p;
+          size_t size;
+        };
+        std::vector<struct iovec> segs_;
+        std::vector<std::shared_ptr<const void> > leases_;
+        std::shared_ptr<const void> lease_;
+        // arena for the copied parts, kept across tokens
+        std::vector<Chunk> arena_;
+        size_t chunk_ {0};
+        size_t used_ {0};
+        std::vector<char> v_;
+        // scratch copy for partial writes
+        std::vector<struct iovec> out_;
+        size_t size_ {0};
+
+        char *allocate(size_t n);
+      public:
+        Segmented(const Segmented &) =delete;
+        Segmented &operator=(const Segmented &) =delete;
+
+        Segmented();
+        Segmented(Segmented &&o);
+        Segmented &operator=(Segmented &&o);
+
+        // lease on the input block that is lexed next, an empty
+        // lease (nullptr) means that input isn't pinned
+        void set_lease(std::shared_ptr<const void> lease);
+
+        void start(const char *p) override;
+        // drops the lease, i.e. the next block needs its own
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override;
+
+        // releases the leases
+        void clear() override;
+
+        const struct iovec *iov() const;
+        int iovcnt() const;
+        size_t size() const;
+        bool empty() const;
+        // the token in contiguous memory - only copies
+        // if there are several segments
+        std::pair<const char*, const char*> contiguous();
+        // writes the token via writev(), in batches of at most
+        // IOV_MAX segments
+        void write(int fd);
+    };
+
+  }
+}
+
+#endif
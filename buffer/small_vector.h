@@ -0,0 +1,162 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_SMALL_VECTOR_H
+#define GMS_BUFFER_SMALL_VECTOR_H
+
+#include <buffer/buffer.h>
+
+#include <cassert>
+#include <stddef.h>
+#include <string.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Like Vector, but parts of spanning tokens are copied into
+    // N bytes of inline storage first - the heap is only used for
+    // tokens that are longer. Thus, small spanning tokens don't
+    // cause an allocation, even in a new or moved-from buffer.
+    template <size_t N> class Small_Vector : public Caller {
+      static_assert(N > 0, "Small_Vector: inline size must not be zero");
+      private:
+        char inline_[N];
+        size_t len_ {0};
+        std::vector<char> v;
+        std::pair<const char*, const char*> range_ {nullptr, nullptr};
+
+        void append(const char *begin, const char *end)
+        {
+          size_t n = end - begin;
+          if (v.empty() && len_ + n <= N) {
+            memcpy(inline_ + len_, begin, n);
+            len_ += n;
+            return;
+          }
+          if (v.empty()) {
+            v.reserve(len_ + n);
+            v.assign(inline_, inline_ + len_);
+            len_ = 0;
+          }
+          v.insert(v.end(), begin, end);
+        }
+      public:
+        Small_Vector(const Small_Vector &) =delete;
+        Small_Vector &operator=(const Small_Vector &) =delete;
+
+        Small_Vector()
+        {
+        }
+        Small_Vector(Small_Vector &&o)
+          : len_(o.len_), v(std::move(o.v)), range_(o.range_)
+        {
+          memcpy(inline_, o.inline_, len_);
+          o.len_ = 0;
+          o.v.clear();
+          o.range_.first = nullptr;
+          o.range_.second = nullptr;
+        }
+        Small_Vector &operator=(Small_Vector &&o)
+        {
+          len_ = o.len_;
+          memcpy(inline_, o.inline_, len_);
+          o.len_ = 0;
+          v = std::move(o.v);
+          o.v.clear();
+          range_ = o.range_;
+          o.range_.first = nullptr;
+          o.range_.second = nullptr;
+          return *this;
+        }
+
+        void start(const char *p) override
+        {
+          Caller::start(p);
+          clear();
+        }
+
+        void commit()
+        {
+          if (range_.first) {
+            const char *b = range_.first;
+            const char *e = range_.second;
+            range_.first = nullptr;
+            range_.second = nullptr;
+            append(b, e);
+          }
+        }
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override
+        {
+          assert(begin<=end);
+          if (begin == end)
+            return;
+          if (last && !len_ && v.empty()) {
+            if (range_.first)
+              throw std::logic_error(
+                  "Small_Vector::buffer_copy(..., last=true) called a 2nd time?");
+            range_.first = begin;
+            range_.second = end;
+          } else {
+            append(begin, end);
+          }
+        }
+
+        // keeps the heap capacity
+        void clear() override
+        {
+          len_ = 0;
+          v.clear();
+          range_.first = nullptr;
+          range_.second = nullptr;
+        }
+        const char *data() const { return begin(); }
+        size_t size() const { return end() - begin(); }
+        bool empty() const { return begin() == end(); }
+        // true if the token is stored on the heap
+        bool on_heap() const { return !v.empty(); }
+        typedef const char * const_iterator ;
+        const_iterator begin() const
+        {
+          if (!v.empty())
+            return v.data();
+          return len_ ? inline_ : range_.first;
+        }
+        const_iterator end() const
+        {
+          if (!v.empty())
+            return v.data() + v.size();
+          return len_ ? inline_ + len_ : range_.second;
+        }
+        std::pair<const char*, const char*> range() const
+        {
+          return std::make_pair(begin(), end());
+        }
+    };
+
+  }
+}
+
+#endif
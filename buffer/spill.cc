@@ -0,0 +1,220 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "spill.h"
+#include "file.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  namespace Buffer {
+
+    static string default_dir()
+    {
+      const char *s = getenv("TMPDIR");
+      return s && *s ? s : "/tmp";
+    }
+
+    Spill::Spill(size_t threshold)
+      : threshold_(threshold), dir_(default_dir())
+    {
+    }
+    Spill::~Spill()
+    {
+      try {
+        unmap();
+        if (fd_ != -1)
+          posix::close(fd_);
+      } catch (const exception &) {
+      }
+    }
+    void Spill::set_threshold(size_t n)
+    {
+      threshold_ = n;
+    }
+    void Spill::set_dir(const std::string &dir)
+    {
+      if (fd_ != -1 && dir != dir_) {
+        unmap();
+        int fd = fd_;
+        fd_ = -1;
+        spilled_ = false;
+        posix::close(fd);
+      }
+      dir_ = dir;
+    }
+
+    void Spill::create()
+    {
+      if (dir_.empty()) {
+        fd_ = memfd_create("libbuffer-spill", MFD_CLOEXEC);
+        if (fd_ == -1)
+          throw runtime_error(string("memfd_create: ") + strerror(errno));
+        return;
+      }
+      string t;
+      fd_ = open_tmpfile(AT_FDCWD, dir_.c_str(), dir_ + "/libbuffer-spill",
+          O_RDWR | O_CLOEXEC, 0600, t);
+      // i.e. the fallback file is just needed for its descriptor
+      if (!t.empty() && ::unlink(t.c_str()) == -1)
+        throw runtime_error(string("unlink: ") + strerror(errno));
+    }
+    void Spill::spill()
+    {
+      if (fd_ == -1)
+        create();
+      spilled_ = true;
+      write(v.data(), v.size());
+      // give the memory back
+      vector<char>().swap(v);
+    }
+    void Spill::write(const char *begin, size_t n)
+    {
+      while (n) {
+        ssize_t r = ::pwrite(fd_, begin, n, size_);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          throw runtime_error(string("pwrite: ") + strerror(errno));
+        }
+        begin += r;
+        n -= r;
+        size_ += r;
+      }
+    }
+    void Spill::unmap()
+    {
+      if (map_) {
+        char *p = map_;
+        map_ = nullptr;
+        posix::munmap(p, map_len_);
+      }
+    }
+
+    void Spill::start(const char *p)
+    {
+      Caller::start(p);
+      clear();
+    }
+
+    void Spill::buffer_copy(const char *begin, const char *end, bool last)
+    {
+      assert(begin<=end);
+      if (begin == end)
+        return;
+      if (last && v.empty() && !spilled_) {
+        if (range_.first)
+          throw std::logic_error(
+              "Spill::buffer_copy(..., last=true) called a 2nd time?");
+        range_.first = begin;
+        range_.second = end;
+        return;
+      }
+      size_t n = end - begin;
+      if (!spilled_ && v.size() + n > threshold_)
+        spill();
+      if (spilled_) {
+        unmap();
+        write(begin, n);
+      } else {
+        v.insert(v.end(), begin, end);
+      }
+    }
+
+    void Spill::clear()
+    {
+      v.clear();
+      range_.first = nullptr;
+      range_.second = nullptr;
+      if (spilled_) {
+        unmap();
+        posix::ftruncate(fd_, 0);
+        spilled_ = false;
+      }
+      size_ = 0;
+    }
+
+    bool Spill::spilled() const
+    {
+      return spilled_;
+    }
+    size_t Spill::size() const
+    {
+      if (spilled_)
+        return size_;
+      return v.empty() ? range_.second - range_.first : v.size();
+    }
+    bool Spill::empty() const
+    {
+      return !size();
+    }
+    std::pair<const char*, const char*> Spill::range()
+    {
+      if (!spilled_) {
+        if (v.empty())
+          return range_;
+        return make_pair(v.data(), v.data() + v.size());
+      }
+      if (!map_) {
+        map_len_ = size_;
+        map_ = static_cast<char*>(posix::mmap(nullptr, map_len_, PROT_READ,
+              MAP_SHARED, fd_, 0));
+      }
+      return make_pair(map_, map_ + map_len_);
+    }
+    size_t Spill::read(uint64_t off, char *b, size_t n) const
+    {
+      if (off >= size())
+        return 0;
+      n = min(n, size_t(size() - off));
+      if (!spilled_) {
+        const char *p = v.empty() ? range_.first : v.data();
+        memcpy(b, p + off, n);
+        return n;
+      }
+      size_t k = 0;
+      while (k < n) {
+        ssize_t r = ::pread(fd_, b + k, n - k, off + k);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          throw runtime_error(string("pread: ") + strerror(errno));
+        }
+        if (!r)
+          break;
+        k += r;
+      }
+      return k;
+    }
+
+  }
+}
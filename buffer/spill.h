@@ -0,0 +1,94 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_SPILL_H
+#define GMS_BUFFER_SPILL_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Behaves like Vector until the copied parts of a token exceed
+    // the threshold - then the token is moved into an unnamed
+    // temporary file (O_TMPFILE in the spill directory, which
+    // defaults to $TMPDIR or /tmp) and the remaining parts are
+    // appended there. Thus, the memory usage per token is bounded.
+    //
+    // With an empty spill directory, a memfd is used instead - note
+    // that its pages are still accounted as (swappable) memory.
+    //
+    // A spilled token is available via range() (maps the file)
+    // or read().
+    class Spill : public Caller {
+      private:
+        std::vector<char> v;
+        std::pair<const char*, const char*> range_ {nullptr, nullptr};
+        size_t threshold_;
+        std::string dir_;
+        int fd_ {-1};
+        bool spilled_ {false};
+        uint64_t size_ {0};
+        char *map_ {nullptr};
+        size_t map_len_ {0};
+
+        void create();
+        void spill();
+        void write(const char *begin, size_t n);
+        void unmap();
+      public:
+        Spill(const Spill &) =delete;
+        Spill &operator=(const Spill &) =delete;
+
+        Spill(size_t threshold = 16 * 1024 * 1024);
+        ~Spill();
+        void set_threshold(size_t n);
+        // empty: use a memfd
+        void set_dir(const std::string &dir);
+
+        void start(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end, bool last)
+          override;
+
+        // truncates the file, which is reused for the next spill
+        void clear() override;
+
+        bool spilled() const;
+        size_t size() const;
+        bool empty() const;
+        // the file is mapped if the token was spilled
+        std::pair<const char*, const char*> range();
+        // copies up to n bytes starting at offset off,
+        // returns the number of copied bytes
+        size_t read(uint64_t off, char *b, size_t n) const;
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "splice.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+namespace Memory {
+
+  // default pipe capacity on Linux
+  static const size_t pipe_size = 64 * 1024;
+
+  Splice::Splice(int in)
+    : in_(in)
+  {
+    struct stat st;
+    posix::fstat(in, &st);
+    pipe_in_ = S_ISFIFO(st.st_mode);
+    if (!pipe_in_ && !S_ISSOCK(st.st_mode))
+      throw logic_error("Splice - input is neither a pipe nor a socket");
+  }
+  Splice::~Splice()
+  {
+    for (int i = 0; i < 2; ++i)
+      if (pipe_[i] != -1)
+        ::close(pipe_[i]);
+  }
+  void Splice::make_pipe()
+  {
+    if (pipe_[0] != -1)
+      return;
+    if (pipe2(pipe_, O_CLOEXEC) == -1)
+      throw runtime_error(string("pipe2: ") + strerror(errno));
+  }
+  size_t Splice::forwarded() const
+  {
+    return forwarded_;
+  }
+
+  size_t Splice::peek(char *buf, size_t n)
+  {
+    if (!pipe_in_) {
+      for (;;) {
+        ssize_t r = recv(in_, buf, n, MSG_PEEK);
+        if (r == -1) {
+          if (errno == EINTR)
+            continue;
+          throw runtime_error(string("recv: ") + strerror(errno));
+        }
+        return r;
+      }
+    }
+    make_pipe();
+    ssize_t r = 0;
+    do
+      r = tee(in_, pipe_[1], min(n, pipe_size), 0);
+    while (r == -1 && errno == EINTR);
+    if (r == -1)
+      throw runtime_error(string("tee: ") + strerror(errno));
+    size_t k = 0;
+    while (k < size_t(r))
+      k += posix::read(pipe_[0], buf + k, r - k);
+    return r;
+  }
+  size_t Splice::read(char *buf, size_t n)
+  {
+    return posix::read(in_, buf, n);
+  }
+
+  void Splice::forward(Buffer::File &f, const char *pe, size_t n)
+  {
+    if (!f.pending()) {
+      forward(f, n);
+      return;
+    }
+    f.pause(pe);
+    forward(f, n);
+    // i.e. the pause() at the end of the Resume scope appends nothing
+    f.resume(pe);
+  }
+  void Splice::forward(Buffer::File &f, size_t n)
+  {
+    if (f.pending())
+      throw logic_error("Splice::forward() - pending token prefix, "
+          "forward it with the end of the read input");
+    if (pipe_in_) {
+      f.splice(in_, n);
+      forwarded_ += n;
+      return;
+    }
+    make_pipe();
+    while (n) {
+      ssize_t r = ::splice(in_, nullptr, pipe_[1], nullptr, min(n, pipe_size),
+          SPLICE_F_MOVE);
+      if (r == -1) {
+        if (errno == EINTR)
+          continue;
+        throw runtime_error(string("splice: ") + strerror(errno));
+      }
+      if (!r)
+        throw runtime_error("Splice::forward() - unexpected end of input");
+      f.splice(pipe_[0], r);
+      n -= r;
+      forwarded_ += r;
+    }
+  }
+
+}
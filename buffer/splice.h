@@ -0,0 +1,77 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_SPLICE_H
+#define GMS_BUFFER_SPLICE_H
+
+#include <buffer/file.h>
+
+#include <stddef.h>
+
+namespace Memory {
+
+  // Passthrough of payload sections from a pipe or a (stream) socket
+  // into a Buffer::File.
+  //
+  // The lexer only reads the boundary regions of the input (e.g.
+  // a header that contains the payload length) and forwards the
+  // payload with forward(), which moves it kernel-side via
+  // splice(2). A socket input is spliced through an internal pipe.
+  //
+  // When the file is used as token buffer and the token starts
+  // in already read input, forward it with the end of the read block,
+  // inside the Resume scope: the pending prefix is appended before the
+  // forwarded bytes - then just finish() the token at the start of
+  // the next read block, as usual.
+  class Splice {
+    private:
+      int in_ {-1};
+      bool pipe_in_ {false};
+      // for socket inputs and for peeking at a pipe
+      int pipe_[2] { -1, -1 };
+      size_t forwarded_ {0};
+
+      void make_pipe();
+    public:
+      Splice(const Splice &) =delete;
+      Splice &operator=(const Splice &) =delete;
+
+      Splice(int in);
+      ~Splice();
+
+      // Copies up to n bytes of the available input into buf, without
+      // consuming them (tee(2) for pipes, MSG_PEEK for sockets).
+      size_t peek(char *buf, size_t n);
+      // Consumes up to n bytes of the input.
+      size_t read(char *buf, size_t n);
+      // Moves exactly n bytes of the input to the end of f,
+      // throws if f has a pending token prefix.
+      void forward(Buffer::File &f, size_t n);
+      // Appends the pending token prefix up to pe (the end of the read
+      // input) and then moves exactly n bytes of the input to f.
+      void forward(Buffer::File &f, const char *pe, size_t n);
+
+      // number of bytes forwarded so far
+      size_t forwarded() const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,502 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_STATIC_H
+#define GMS_BUFFER_STATIC_H
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // Header-only counterparts of Caller/Vector/File.
+    //
+    // They have the same semantics as the polymorphic classes, but
+    // buffer_copy() is resolved at compile time (CRTP), such
+    // that a lexer that is parametrized over the buffer type
+    // gets start()/finish() etc. inlined.
+    //
+    // Use Static::Adapter to plug a static buffer into
+    // code that expects a Base, e.g. a Proxy.
+    namespace Static {
+
+      template <typename Derived> class Caller {
+        private:
+          const char *first { nullptr };
+
+          Derived &self() { return static_cast<Derived&>(*this); }
+        protected:
+          bool active_ {false};
+        public:
+          void clear()
+          {
+            throw std::logic_error("clear not implemented");
+          }
+
+          void start(const char *p)
+          {
+            assert(p);
+            first = p;
+            active_ = true;
+          }
+          void cont(const char *p)
+          {
+            assert(p);
+            first = p;
+            active_ = true;
+          }
+
+          void stop(const char *p)
+          {
+            if (!first)
+              return;
+            self().buffer_copy(first, p, false);
+            first = nullptr;
+            active_ = false;
+          }
+          void finish(const char *p)
+          {
+            if (!first)
+              return;
+            self().buffer_copy(first, p, true);
+            first = nullptr;
+            active_ = false;
+          }
+          void finish()
+          {
+            // also after pause(), i.e. when first isn't set
+            if (!active_)
+              return;
+            self().buffer_copy(nullptr, nullptr, true);
+            first = nullptr;
+            active_ = false;
+          }
+
+          void resume(const char *p)
+          {
+            assert(p);
+            if (!active_)
+              return;
+            first = p;
+          }
+          void pause(const char *p)
+          {
+            if (!active_)
+              return;
+            self().buffer_copy(first, p, false);
+            first = nullptr;
+          }
+
+          const char *pending() const
+          {
+            return active_ ? first : nullptr;
+          }
+      };
+
+      class Vector : public Caller<Vector> {
+        private:
+          std::vector<char> v;
+          std::pair<const char*, const char*> range_ {nullptr, nullptr};
+        public:
+          Vector(const Vector &) =delete;
+          Vector &operator=(const Vector &) =delete;
+
+          Vector()
+          {
+          }
+          Vector(Vector &&o)
+            : v(std::move(o.v)), range_(o.range_)
+          {
+            o.range_.first = nullptr;
+            o.range_.second = nullptr;
+          }
+          Vector &operator=(Vector &&o)
+          {
+            v = std::move(o.v);
+            range_ = o.range_;
+            o.range_.first = nullptr;
+            o.range_.second = nullptr;
+            return *this;
+          }
+
+          void start(const char *p)
+          {
+            Caller<Vector>::start(p);
+            clear();
+          }
+
+          void commit()
+          {
+            if (range_.first) {
+              v.insert(v.end(), range_.first, range_.second);
+              range_.first = nullptr;
+              range_.second = nullptr;
+            }
+          }
+
+          void buffer_copy(const char *begin, const char *end, bool last)
+          {
+            assert(begin<=end);
+            if (begin == end)
+              return;
+            if (last && v.empty()) {
+              if (range_.first)
+                throw std::logic_error(
+                    "Vector::buffer_copy(..., last=true) called a 2nd time?");
+              range_.first = begin;
+              range_.second = end;
+            } else {
+              v.insert(v.end(), begin, end);
+            }
+          }
+
+          void clear()
+          {
+            v.clear();
+            range_.first = nullptr;
+            range_.second = nullptr;
+          }
+          const char *data() const { return begin(); }
+          size_t size() const { return end() - begin(); }
+          bool empty() const { return begin() == end(); }
+          typedef const char * const_iterator ;
+          const_iterator begin() const
+          {
+            return v.empty() ? range_.first : v.data();
+          }
+          const_iterator end() const
+          {
+            return v.empty() ? range_.second : v.data() + v.size();
+          }
+          std::pair<const char*, const char*> range() const
+          {
+            return std::make_pair(begin(), end());
+          }
+      };
+
+      // Writes into an opened Buffer::File - only the token boundary
+      // handling is inlined, the actual write is still done
+      // by Buffer::File.
+      class File : public Caller<File> {
+        private:
+          Buffer::File &f_;
+        public:
+          File(Buffer::File &f)
+            : f_(f)
+          {
+          }
+          void clear()
+          {
+          }
+          void buffer_copy(const char *begin, const char *end, bool last)
+          {
+            if (begin == end)
+              return;
+            f_.Buffer::File::buffer_copy(begin, end, last);
+          }
+      };
+
+      // ignores all input
+      class Null {
+        public:
+          void clear() {}
+
+          void start(const char *) {}
+          void cont(const char *) {}
+
+          void stop(const char *) {}
+          void finish(const char *) {}
+          void finish() {}
+
+          void resume(const char *) {}
+          void pause(const char *) {}
+
+          void buffer_copy(const char *, const char *, bool) {}
+
+          const char *pending() const { return nullptr; }
+      };
+
+      namespace Detail {
+
+        // index of T in Ts...
+        template <typename T, typename... Ts> struct Index;
+        template <typename T, typename... Ts> struct Index<T, T, Ts...> {
+          static const unsigned value = 0;
+        };
+        template <typename T, typename U, typename... Ts>
+          struct Index<T, U, Ts...> {
+            static const unsigned value = 1 + Index<T, Ts...>::value;
+          };
+
+        // calls f on the i-th alternative - the compiler turns
+        // the comparison chain into a switch;
+        // i == sizeof...(Ts) selects the null alternative
+        template <unsigned I, typename... Ts> struct Visit;
+        template <unsigned I> struct Visit<I> {
+          template <typename F> static void apply(unsigned, void *, const F &)
+          {
+          }
+        };
+        template <unsigned I, typename T, typename... Ts>
+          struct Visit<I, T, Ts...> {
+            template <typename F>
+              static void apply(unsigned i, void *b, const F &f)
+              {
+                if (i == I)
+                  f(*static_cast<T*>(b));
+                else
+                  Visit<I+1, Ts...>::apply(i, b, f);
+              }
+          };
+
+        struct Clear {
+          template <typename B> void operator()(B &b) const { b.clear(); }
+        };
+#define GMS_BUFFER_STATIC_OP(NAME, CALL) \
+        struct NAME { \
+          const char *p; \
+          template <typename B> void operator()(B &b) const { b.CALL(p); } \
+        };
+        GMS_BUFFER_STATIC_OP(Start, start)
+        GMS_BUFFER_STATIC_OP(Cont, cont)
+        GMS_BUFFER_STATIC_OP(Stop, stop)
+        GMS_BUFFER_STATIC_OP(Finish, finish)
+        GMS_BUFFER_STATIC_OP(Resume, resume)
+        GMS_BUFFER_STATIC_OP(Pause, pause)
+#undef GMS_BUFFER_STATIC_OP
+        struct Finish_End {
+          template <typename B> void operator()(B &b) const { b.finish(); }
+        };
+        struct Buffer_Copy {
+          const char *begin;
+          const char *end;
+          bool last;
+          template <typename B> void operator()(B &b) const
+          {
+            b.buffer_copy(begin, end, last);
+          }
+        };
+        struct Pending {
+          const char **r;
+          template <typename B> void operator()(B &b) const
+          {
+            *r = b.pending();
+          }
+        };
+        // *r stays set only if all buffers agree
+        struct Common_Pending {
+          const char **r;
+          bool *first;
+          template <typename B> void operator()(B &b) const
+          {
+            const char *p = b.pending();
+            if (*first)
+              *r = p;
+            else if (*r != p)
+              *r = nullptr;
+            *first = false;
+          }
+        };
+
+        // calls f on each element of a tuple of pointers
+        template <size_t I, size_t N> struct Each {
+          template <typename T, typename F>
+            static void apply(const T &t, const F &f)
+            {
+              f(*std::get<I>(t));
+              Each<I+1, N>::apply(t, f);
+            }
+        };
+        template <size_t N> struct Each<N, N> {
+          template <typename T, typename F>
+            static void apply(const T &, const F &)
+            {
+            }
+        };
+
+      }
+
+      // Closed-set counterpart of Buffer::Proxy: forwards to one
+      // of the buffers of type Ts... (not owned), or ignores the input
+      // when set to nullptr. Switching targets is just a pointer/index
+      // assignment and forwarding does not involve a virtual call.
+      template <typename... Ts> class Proxy {
+        private:
+          void *b { nullptr };
+          unsigned i { sizeof...(Ts) };
+
+          template <typename F> void apply(const F &f)
+          {
+            Detail::Visit<0, Ts...>::apply(i, b, f);
+          }
+        public:
+          Proxy()
+          {
+          }
+          template <typename T> Proxy(T *b)
+          {
+            set(b);
+          }
+          template <typename T> void set(T *b)
+          {
+            if (b) {
+              this->b = b;
+              i = Detail::Index<T, Ts...>::value;
+            } else {
+              set(nullptr);
+            }
+          }
+          void set(std::nullptr_t)
+          {
+            b = nullptr;
+            i = sizeof...(Ts);
+          }
+
+          void clear() { apply(Detail::Clear()); }
+
+          void start(const char *p) { apply(Detail::Start{p}); }
+          void cont(const char *p) { apply(Detail::Cont{p}); }
+
+          void stop(const char *p) { apply(Detail::Stop{p}); }
+          void finish(const char *p) { apply(Detail::Finish{p}); }
+          void finish() { apply(Detail::Finish_End()); }
+
+          void resume(const char *p) { apply(Detail::Resume{p}); }
+          void pause(const char *p) { apply(Detail::Pause{p}); }
+
+          void buffer_copy(const char *begin, const char *end, bool last)
+          {
+            apply(Detail::Buffer_Copy{begin, end, last});
+          }
+
+          const char *pending() const
+          {
+            const char *r = nullptr;
+            Detail::Visit<0, Ts...>::apply(i, b, Detail::Pending{&r});
+            return r;
+          }
+      };
+
+      // Fixed-arity counterpart of Buffer::Tee: forwards to all
+      // of the buffers of type Ts... (not owned), without virtual calls.
+      template <typename... Ts> class Tee {
+        private:
+          std::tuple<Ts*...> t;
+
+          template <typename F> void apply(const F &f)
+          {
+            Detail::Each<0, sizeof...(Ts)>::apply(t, f);
+          }
+        public:
+          Tee(Ts&... bs)
+            : t(&bs...)
+          {
+          }
+
+          void clear() { apply(Detail::Clear()); }
+
+          void start(const char *p) { apply(Detail::Start{p}); }
+          void cont(const char *p) { apply(Detail::Cont{p}); }
+
+          void stop(const char *p) { apply(Detail::Stop{p}); }
+          void finish(const char *p) { apply(Detail::Finish{p}); }
+          void finish() { apply(Detail::Finish_End()); }
+
+          void resume(const char *p) { apply(Detail::Resume{p}); }
+          void pause(const char *p) { apply(Detail::Pause{p}); }
+
+          void buffer_copy(const char *begin, const char *end, bool last)
+          {
+            apply(Detail::Buffer_Copy{begin, end, last});
+          }
+
+          const char *pending() const
+          {
+            const char *r = nullptr;
+            bool first = true;
+            Detail::Each<0, sizeof...(Ts)>::apply(t,
+                Detail::Common_Pending{&r, &first});
+            return r;
+          }
+      };
+
+      template <typename B> class Resume {
+        private:
+          B &b;
+          const char *&pe;
+        public:
+          Resume(B &b, const char *p, const char *&pe)
+            : b(b), pe(pe)
+          {
+            b.resume(p);
+          }
+          ~Resume()
+          {
+            b.pause(pe);
+          }
+      };
+
+      // Makes a static buffer available via the Base interface.
+      template <typename B> class Adapter : public Base {
+        private:
+          B &b;
+        public:
+          Adapter(B &b)
+            : b(b)
+          {
+          }
+          B &get() { return b; }
+
+          void clear() override { b.clear(); }
+
+          void start(const char *p) override { b.start(p); }
+          void cont(const char *p) override { b.cont(p); }
+
+          void stop(const char *p) override { b.stop(p); }
+          void finish(const char *p) override { b.finish(p); }
+          void finish() override { b.finish(); }
+
+          void resume(const char *p) override { b.resume(p); }
+          void pause(const char *p) override { b.pause(p); }
+
+          void buffer_copy(const char *begin, const char *end,
+              bool last) override
+          {
+            b.buffer_copy(begin, end, last);
+          }
+
+          const char *pending() const override { return b.pending(); }
+      };
+
+    }
+
+  }
+}
+
+#endif
@@ -0,0 +1,123 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_STATS_H
+#define GMS_BUFFER_STATS_H
+
+// Instrumentation - disabled by default, thus, it compiles to nothing.
+//
+// GMS_BUFFER_STATS: counters and histograms per buffer (Caller),
+//                   cf. Caller::stats()
+// GMS_BUFFER_SDT:   USDT probes (provider libbuffer) for perf/bpftrace,
+//                   requires sys/sdt.h (systemtap-sdt-devel)
+//
+// Both have to be defined consistently for the library
+// and its users (cf. the BUFFER_STATS/BUFFER_SDT CMake options),
+// since the counters change the layout of Caller.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <chrono>
+
+#ifdef GMS_BUFFER_SDT
+  #include <sys/sdt.h>
+  #define GMS_BUFFER_PROBE1(name, a) DTRACE_PROBE1(libbuffer, name, a)
+  #define GMS_BUFFER_PROBE2(name, a, b) DTRACE_PROBE2(libbuffer, name, a, b)
+#else
+  #define GMS_BUFFER_PROBE1(name, a)
+  #define GMS_BUFFER_PROBE2(name, a, b)
+#endif
+
+#ifdef GMS_BUFFER_STATS
+  #define GMS_BUFFER_STAT(x) x
+#else
+  #define GMS_BUFFER_STAT(x)
+#endif
+
+namespace Memory {
+
+  namespace Buffer {
+
+    // log2 buckets: bucket 0 counts 0, bucket i > 0 counts values
+    // in [2^(i-1), 2^i)
+    class Histogram {
+      private:
+        std::array<uint64_t, 65> b_ {{}};
+      public:
+        static unsigned bucket(uint64_t x)
+        {
+          return x ? 64 - __builtin_clzll(x) : 0;
+        }
+        void add(uint64_t x) { ++b_[bucket(x)]; }
+        uint64_t operator[](unsigned i) const { return b_[i]; }
+        size_t size() const { return b_.size(); }
+        uint64_t count() const
+        {
+          uint64_t r = 0;
+          for (auto x : b_)
+            r += x;
+          return r;
+        }
+        void clear() { b_.fill(0); }
+    };
+
+    struct Stats {
+      uint64_t tokens {0};
+      // finished by reference, i.e. without copying
+      uint64_t zero_copy {0};
+      // tokens that span blocks
+      uint64_t spanning {0};
+      // copied by the buffer, e.g. into the Vector or the write buffer
+      uint64_t bytes_copied {0};
+      // passed on pause(), i.e. at the end of a block
+      uint64_t paused_bytes {0};
+      uint64_t reallocations {0};
+      Histogram token_length;
+      Histogram blocks_per_token;
+      // File::close()
+      Histogram fsync_ns;
+
+      void clear() { *this = Stats(); }
+    };
+
+    // nanoseconds since construction - only measured
+    // if the instrumentation is enabled
+    class Timer {
+#if defined(GMS_BUFFER_STATS) || defined(GMS_BUFFER_SDT)
+      private:
+        std::chrono::steady_clock::time_point t_
+          {std::chrono::steady_clock::now()};
+      public:
+        uint64_t ns() const
+        {
+          return std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - t_).count();
+        }
+#else
+      public:
+        uint64_t ns() const { return 0; }
+#endif
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,322 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "streams.h"
+
+#include <cassert>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  static const size_t min_chunk = 64;
+
+  Slab_Pool::Slab_Pool(size_t slab_size)
+    : slab_size_(slab_size)
+  {
+    if (slab_size < min_chunk)
+      throw logic_error("Slab_Pool: slab size too small");
+  }
+  unsigned Slab_Pool::size_class(size_t n)
+  {
+    unsigned r = 0;
+    while (capacity(r) < n)
+      ++r;
+    return r;
+  }
+  size_t Slab_Pool::capacity(unsigned cls)
+  {
+    return min_chunk << cls;
+  }
+  Slab_Pool::Slab &Slab_Pool::slab(char *p)
+  {
+    auto i = slabs_.upper_bound(p);
+    assert(i != slabs_.begin());
+    --i;
+    assert(p < i->first + slab_size_);
+    return i->second;
+  }
+  char *Slab_Pool::get(unsigned cls)
+  {
+    size_t n = capacity(cls);
+    in_use_ += n;
+    if (n > slab_size_ / 4)
+      return new char[n];
+    if (avail_.size() <= cls) {
+      avail_.resize(cls + 1);
+      empty_.resize(cls + 1);
+    }
+    auto &a = avail_[cls];
+    if (a.empty()) {
+      Slab s;
+      s.mem.reset(new char[slab_size_]);
+      s.cls = cls;
+      s.chunks = slab_size_ / n;
+      char *p = s.mem.get();
+      for (size_t i = s.chunks; i > 0; --i)
+        s.free.push_back(p + (i - 1) * n);
+      a.push_back(&(slabs_[p] = std::move(s)));
+      ++empty_[cls];
+    }
+    Slab &s = *a.back();
+    if (s.free.size() == s.chunks)
+      --empty_[cls];
+    char *r = s.free.back();
+    s.free.pop_back();
+    if (s.free.empty())
+      a.pop_back();
+    return r;
+  }
+  void Slab_Pool::put(char *p, unsigned cls)
+  {
+    size_t n = capacity(cls);
+    in_use_ -= n;
+    if (n > slab_size_ / 4) {
+      delete[] p;
+      return;
+    }
+    Slab &s = slab(p);
+    assert(s.cls == cls);
+    auto &a = avail_[cls];
+    if (s.free.empty())
+      a.push_back(&s);
+    s.free.push_back(p);
+    if (s.free.size() < s.chunks)
+      return;
+    if (!empty_[cls]) {
+      ++empty_[cls];
+      return;
+    }
+    // i.e. keep just one empty slab per class
+    a.erase(find(a.begin(), a.end(), &s));
+    slabs_.erase(s.mem.get());
+  }
+  size_t Slab_Pool::slabs() const
+  {
+    return slabs_.size();
+  }
+  size_t Slab_Pool::in_use() const
+  {
+    return in_use_;
+  }
+
+  namespace Buffer {
+
+    const size_t Streams::npos;
+
+    Streams::Streams()
+    {
+    }
+    Streams::~Streams()
+    {
+      for (auto &s : states_)
+        release(s);
+    }
+
+    Streams::State &Streams::cur()
+    {
+      if (cur_ == npos)
+        throw logic_error("Streams: no current stream");
+      return states_[cur_];
+    }
+    const Streams::State &Streams::cur() const
+    {
+      if (cur_ == npos)
+        throw logic_error("Streams: no current stream");
+      return states_[cur_];
+    }
+
+    size_t Streams::open()
+    {
+      size_t id;
+      if (free_ids_.empty()) {
+        id = states_.size();
+        states_.emplace_back();
+      } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+      }
+      states_[id].open = true;
+      return id;
+    }
+    void Streams::close(size_t id)
+    {
+      if (id >= states_.size() || !states_[id].open)
+        throw logic_error("Streams: stream isn't open");
+      release(states_[id]);
+      states_[id] = State();
+      free_ids_.push_back(id);
+      if (id == cur_)
+        cur_ = npos;
+    }
+    void Streams::set(size_t id)
+    {
+      if (id >= states_.size() || !states_[id].open)
+        throw logic_error("Streams: stream isn't open");
+      cur_ = id;
+    }
+    size_t Streams::id() const
+    {
+      return cur_;
+    }
+    size_t Streams::size() const
+    {
+      return states_.size() - free_ids_.size();
+    }
+    const Slab_Pool &Streams::pool() const
+    {
+      return pool_;
+    }
+
+    void Streams::release(State &s)
+    {
+      if (s.buf)
+        pool_.put(s.buf, s.cls);
+      s.buf = nullptr;
+      s.len = 0;
+      s.cls = 0;
+      s.begin = nullptr;
+      s.end = nullptr;
+    }
+    void Streams::append(State &s, const char *begin, const char *end)
+    {
+      size_t n = end - begin;
+      if (size_t(s.len) + n > numeric_limits<uint32_t>::max())
+        throw length_error("Streams: token too large");
+      if (!s.buf || s.len + n > Slab_Pool::capacity(s.cls)) {
+        unsigned cls = Slab_Pool::size_class(s.len + n);
+        char *b = pool_.get(cls);
+        if (s.buf) {
+          memcpy(b, s.buf, s.len);
+          pool_.put(s.buf, s.cls);
+        }
+        s.buf = b;
+        s.cls = cls;
+      }
+      memcpy(s.buf + s.len, begin, n);
+      s.len += n;
+    }
+
+    void Streams::clear()
+    {
+      if (cur_ == npos)
+        return;
+      release(cur());
+    }
+
+    void Streams::start(const char *p)
+    {
+      assert(p);
+      State &s = cur();
+      release(s);
+      s.first = p;
+      s.active = true;
+    }
+    void Streams::cont(const char *p)
+    {
+      assert(p);
+      State &s = cur();
+      s.first = p;
+      s.active = true;
+    }
+    void Streams::stop(const char *p)
+    {
+      State &s = cur();
+      if (!s.first)
+        return;
+      buffer_copy(s.first, p, false);
+      s.first = nullptr;
+      s.active = false;
+    }
+    void Streams::finish(const char *p)
+    {
+      State &s = cur();
+      if (!s.first)
+        return;
+      buffer_copy(s.first, p, true);
+      s.first = nullptr;
+      s.active = false;
+    }
+    void Streams::finish()
+    {
+      State &s = cur();
+      if (!s.active)
+        return;
+      buffer_copy(nullptr, nullptr, true);
+      s.first = nullptr;
+      s.active = false;
+    }
+    void Streams::resume(const char *p)
+    {
+      assert(p);
+      State &s = cur();
+      if (!s.active)
+        return;
+      s.first = p;
+    }
+    void Streams::pause(const char *p)
+    {
+      State &s = cur();
+      if (!s.active)
+        return;
+      buffer_copy(s.first, p, false);
+      s.first = nullptr;
+    }
+    void Streams::buffer_copy(const char *begin, const char *end,
+        bool last)
+    {
+      assert(begin<=end);
+      State &s = cur();
+      if (last && !s.len) {
+        s.begin = begin;
+        s.end = end;
+        return;
+      }
+      if (begin != end)
+        append(s, begin, end);
+      if (last) {
+        s.begin = s.buf;
+        s.end = s.buf + s.len;
+      }
+    }
+    const char *Streams::pending() const
+    {
+      const State &s = cur();
+      return s.active ? s.first : nullptr;
+    }
+
+    Streams::const_iterator Streams::begin() const
+    {
+      return cur().begin;
+    }
+    Streams::const_iterator Streams::end() const
+    {
+      return cur().end;
+    }
+    std::pair<const char*, const char*> Streams::range() const
+    {
+      return make_pair(begin(), end());
+    }
+
+  }
+}
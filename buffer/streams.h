@@ -0,0 +1,163 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_STREAMS_H
+#define GMS_BUFFER_STREAMS_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Memory {
+
+  // Size-classed allocator for token storage: class k holds
+  // 64 << k bytes. Small classes are carved from slabs, each slab
+  // keeps a free-list of its chunks; larger chunks are allocated
+  // directly. A slab whose chunks are all free is returned, except
+  // for one per class (such that a class that oscillates around
+  // a slab boundary doesn't allocate each time). Thus, the resident
+  // memory follows the bytes in use and not their historical peak.
+  class Slab_Pool {
+    private:
+      struct Slab {
+        std::unique_ptr<char[]> mem;
+        std::vector<char*> free;
+        unsigned cls;
+        size_t chunks;
+      };
+      size_t slab_size_;
+      // by start address
+      std::map<char*, Slab> slabs_;
+      // per class: slabs with free chunks, number of empty slabs
+      std::vector<std::vector<Slab*> > avail_;
+      std::vector<size_t> empty_;
+      size_t in_use_ {0};
+
+      Slab &slab(char *p);
+    public:
+      Slab_Pool(const Slab_Pool &) =delete;
+      Slab_Pool &operator=(const Slab_Pool &) =delete;
+
+      Slab_Pool(size_t slab_size = 256 * 1024);
+
+      // smallest class that holds n bytes
+      static unsigned size_class(size_t n);
+      static size_t capacity(unsigned cls);
+
+      char *get(unsigned cls);
+      void put(char *p, unsigned cls);
+
+      size_t slabs() const;
+      // bytes handed out
+      size_t in_use() const;
+  };
+
+  namespace Buffer {
+
+    // Buffer state for many streams (e.g. one lexer per connection)
+    // in one table. Only the partial tokens that span blocks are
+    // copied into pool storage, which is released when the next token
+    // of that stream starts (or on clear()/close()) - thus, the memory
+    // usage is proportional to the bytes in flight and not to the
+    // number of streams times the largest token (as with a Vector per
+    // stream, which never shrinks).
+    //
+    // Like Proxy::set(), set() just switches the current stream, all
+    // other calls apply to the current stream. A token that is
+    // located in one block is referenced (as with Vector). Closing
+    // the current stream unsets it, without a current stream the
+    // calls throw a logic_error.
+    class Streams : public Base {
+      private:
+        struct State {
+          const char *first {nullptr};
+          // finished token
+          const char *begin {nullptr};
+          const char *end {nullptr};
+          char *buf {nullptr};
+          uint32_t len {0};
+          uint8_t cls {0};
+          bool active {false};
+          bool open {false};
+        };
+        Slab_Pool pool_;
+        std::vector<State> states_;
+        std::vector<size_t> free_ids_;
+        // npos if there is no current stream
+        size_t cur_ {npos};
+
+        State &cur();
+        const State &cur() const;
+        void append(State &s, const char *begin, const char *end);
+        void release(State &s);
+      public:
+        static const size_t npos = size_t(-1);
+
+        Streams(const Streams &) =delete;
+        Streams &operator=(const Streams &) =delete;
+
+        Streams();
+        ~Streams();
+
+        // returns the id of a new stream, ids of closed
+        // streams are reused
+        size_t open();
+        void close(size_t id);
+        void set(size_t id);
+        // npos if there is no current stream
+        size_t id() const;
+        // number of open streams
+        size_t size() const;
+        const Slab_Pool &pool() const;
+
+        // releases the storage of the current stream
+        void clear() override;
+
+        void start(const char *p) override;
+        void cont(const char *p) override;
+
+        void stop(const char *p) override;
+        void finish(const char *p) override;
+        void finish() override;
+
+        void resume(const char *p) override;
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end,
+            bool last) override;
+
+        const char *pending() const override;
+
+        // finished token of the current stream
+        typedef const char * const_iterator ;
+        const_iterator begin() const ;
+        const_iterator end() const ;
+        std::pair<const char*, const char*> range() const;
+    };
+
+  }
+}
+
+#endif
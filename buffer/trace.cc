@@ -0,0 +1,238 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include "trace.h"
+#include <ixxx/ixxx.h>
+using namespace ixxx;
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+namespace Memory {
+
+  static const char magic[] = "LBTRACE1";
+
+  void Trace::count(Op op, size_t off)
+  {
+    if (op > CLEAR)
+      throw runtime_error("Trace: unknown opcode");
+    ++events_;
+    if (op == FINISH || op == FINISH_END)
+      ++tokens_;
+    if (op == RESUME)
+      ++blocks_;
+    max_off_ = max(max_off_, off);
+  }
+  void Trace::add(Op op, size_t off)
+  {
+    count(op, off);
+    v_.push_back(op);
+    uint64_t x = off;
+    do {
+      unsigned char c = x & 0x7f;
+      x >>= 7;
+      v_.push_back(x ? c | 0x80 : c);
+    } while (x);
+  }
+  void Trace::clear()
+  {
+    v_.clear();
+    events_ = 0;
+    tokens_ = 0;
+    blocks_ = 0;
+    max_off_ = 0;
+  }
+
+  void Trace::save(const std::string &filename) const
+  {
+    int fd = posix::open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC,
+        0666);
+    try {
+      const unsigned char *p = v_.data();
+      size_t n = v_.size();
+      posix::write(fd, magic, sizeof(magic) - 1);
+      while (n) {
+        size_t k = posix::write(fd, p, n);
+        p += k;
+        n -= k;
+      }
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    posix::close(fd);
+  }
+  void Trace::load(const std::string &filename)
+  {
+    clear();
+    int fd = posix::open(filename.c_str(), O_RDONLY);
+    try {
+      char m[sizeof(magic) - 1];
+      if (posix::read(fd, m, sizeof m) != sizeof m
+          || memcmp(m, magic, sizeof m))
+        throw runtime_error("Trace: no trace file: " + filename);
+      char b[64 * 1024];
+      for (;;) {
+        size_t n = posix::read(fd, b, sizeof b);
+        if (!n)
+          break;
+        v_.insert(v_.end(), b, b + n);
+      }
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    posix::close(fd);
+    try {
+      for_each([this](Op op, size_t off) { count(op, off); });
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  size_t Trace::events() const
+  {
+    return events_;
+  }
+  size_t Trace::tokens() const
+  {
+    return tokens_;
+  }
+  size_t Trace::blocks() const
+  {
+    return blocks_;
+  }
+  size_t Trace::max_offset() const
+  {
+    return max_off_;
+  }
+  size_t Trace::size() const
+  {
+    return v_.size();
+  }
+
+  namespace Buffer {
+
+    Recorder::Recorder(Trace &t, Base *b)
+      : t_(t), b_(b)
+    {
+    }
+    void Recorder::set(Base *b)
+    {
+      b_.set(b);
+    }
+    size_t Recorder::offset(const char *p)
+    {
+      if (!base_) {
+        // used without resume(), e.g. on a mapped input
+        base_ = p;
+        t_.add(Trace::RESUME);
+      }
+      if (p < base_)
+        throw logic_error("Recorder: pointer before the block start");
+      return p - base_;
+    }
+
+    void Recorder::clear()
+    {
+      t_.add(Trace::CLEAR);
+      b_.clear();
+    }
+    void Recorder::start(const char *p)
+    {
+      t_.add(Trace::START, offset(p));
+      b_.start(p);
+    }
+    void Recorder::cont(const char *p)
+    {
+      t_.add(Trace::CONT, offset(p));
+      b_.cont(p);
+    }
+    void Recorder::stop(const char *p)
+    {
+      t_.add(Trace::STOP, offset(p));
+      b_.stop(p);
+    }
+    void Recorder::finish(const char *p)
+    {
+      t_.add(Trace::FINISH, offset(p));
+      b_.finish(p);
+    }
+    void Recorder::finish()
+    {
+      t_.add(Trace::FINISH_END);
+      b_.finish();
+    }
+    void Recorder::resume(const char *p)
+    {
+      base_ = p;
+      t_.add(Trace::RESUME);
+      b_.resume(p);
+    }
+    void Recorder::pause(const char *p)
+    {
+      t_.add(Trace::PAUSE, offset(p));
+      base_ = nullptr;
+      b_.pause(p);
+    }
+    void Recorder::buffer_copy(const char *begin, const char *end,
+        bool last)
+    {
+      b_.buffer_copy(begin, end, last);
+    }
+    const char *Recorder::pending() const
+    {
+      // a driver must not relocate the block, since
+      // offsets are relative to it
+      return nullptr;
+    }
+
+  }
+
+  Replay::Replay(const Trace &t)
+    : t_(t), block_(max(t.max_offset(), size_t(1)), 'x')
+  {
+  }
+  size_t Replay::run(Buffer::Base &b)
+  {
+    size_t tokens = 0;
+    const char *p = block_.data();
+    t_.for_each([&b, &tokens, p](Trace::Op op, size_t off) {
+        switch (op) {
+          case Trace::RESUME: b.resume(p); break;
+          case Trace::PAUSE: b.pause(p + off); break;
+          case Trace::START: b.start(p + off); break;
+          case Trace::CONT: b.cont(p + off); break;
+          case Trace::STOP: b.stop(p + off); break;
+          case Trace::FINISH: b.finish(p + off); ++tokens; break;
+          case Trace::FINISH_END: b.finish(); ++tokens; break;
+          case Trace::CLEAR: b.clear(); break;
+        }
+      });
+    return tokens;
+  }
+
+}
@@ -0,0 +1,143 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_BUFFER_TRACE_H
+#define GMS_BUFFER_TRACE_H
+
+#include <buffer/buffer.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Memory {
+
+  // Shape of a lexer run: the block (read) sizes and the token
+  // boundaries as offsets into the blocks - the input itself isn't
+  // recorded. The events are stored as opcode plus varint offset,
+  // i.e. mostly 2-3 bytes per event.
+  class Trace {
+    public:
+      enum Op : unsigned char {
+        RESUME, PAUSE, START, CONT, STOP, FINISH, FINISH_END, CLEAR
+      };
+    private:
+      std::vector<unsigned char> v_;
+      size_t events_ {0};
+      size_t tokens_ {0};
+      size_t blocks_ {0};
+      // largest offset, i.e. the size of the replay block
+      size_t max_off_ {0};
+
+      void count(Op op, size_t off);
+    public:
+      // off: PAUSE - block length, START etc. - offset into the block
+      void add(Op op, size_t off = 0);
+      void clear();
+
+      void save(const std::string &filename) const;
+      // throws a runtime_error on a corrupt or truncated trace
+      void load(const std::string &filename);
+
+      // calls f(Op, size_t off) for each event
+      template <typename F> void for_each(F f) const;
+
+      size_t events() const;
+      size_t tokens() const;
+      size_t blocks() const;
+      size_t max_offset() const;
+      // encoded size in bytes
+      size_t size() const;
+  };
+
+  namespace Buffer {
+
+    // Like Proxy, forwards to a target (or nothing) - and records
+    // the calls into a Trace.
+    class Recorder : public Base {
+      private:
+        Trace &t_;
+        Proxy b_;
+        const char *base_ {nullptr};
+
+        size_t offset(const char *p);
+      public:
+        Recorder(Trace &t, Base *b = nullptr);
+        void set(Base *b);
+
+        void clear() override;
+
+        void start(const char *p) override;
+        void cont(const char *p) override;
+
+        void stop(const char *p) override;
+        void finish(const char *p) override;
+        void finish() override;
+
+        void resume(const char *p) override;
+        void pause(const char *p) override;
+
+        void buffer_copy(const char *begin, const char *end,
+            bool last) override;
+
+        const char *pending() const override;
+    };
+
+  }
+
+  // Replays a trace against any buffer, using one block of filler
+  // bytes that is reused like the read buffer of a reader.
+  class Replay {
+    private:
+      const Trace &t_;
+      std::vector<char> block_;
+    public:
+      Replay(const Trace &t);
+      // returns the number of finished tokens
+      size_t run(Buffer::Base &b);
+  };
+
+  template <typename F> void Trace::for_each(F f) const
+  {
+    const unsigned char *p = v_.data();
+    const unsigned char *pe = p + v_.size();
+    while (p != pe) {
+      Op op = Op(*p++);
+      uint64_t off = 0;
+      for (unsigned shift = 0; ; shift += 7) {
+        if (p == pe)
+          throw std::runtime_error("Trace: truncated event");
+        unsigned char c = *p++;
+        // the 10th byte may only contribute the highest bit
+        if (shift > 63 || (shift == 63 && (c & 0x7e)))
+          throw std::runtime_error("Trace: offset out of range");
+        off |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80))
+          break;
+      }
+      f(op, size_t(off));
+    }
+  }
+
+}
+
+#endif
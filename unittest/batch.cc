@@ -0,0 +1,128 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/batch.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( batch )
+
+    BOOST_AUTO_TEST_CASE( block )
+    {
+      using namespace Memory;
+      vector<vector<string> > batches;
+      vector<size_t> refs;
+      const char i[] = "foo bar baz";
+      Buffer::Batch b([&](const Buffer::Batch &b) {
+          batches.emplace_back();
+          size_t r = 0;
+          for (size_t k = 0; k < b.size(); ++k) {
+            batches.back().emplace_back(b[k].first, b[k].second);
+            if (b[k].first >= i && b[k].second <= i + sizeof(i))
+              ++r;
+          }
+          refs.push_back(r);
+        });
+      const char *pe = i + sizeof(i) - 1;
+      {
+        Buffer::Resume r(b, i, pe);
+        b.start(i);
+        b.finish(i + 3);
+        b.start(i + 4);
+        b.finish(i + 7);
+        b.start(i + 8);
+        b.finish(i + 11);
+      }
+      BOOST_REQUIRE_EQUAL(batches.size(), 1u);
+      const vector<string> ref = { "foo", "bar", "baz" };
+      BOOST_CHECK_EQUAL_COLLECTIONS(batches[0].begin(), batches[0].end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK_EQUAL(refs[0], 3u);
+      BOOST_CHECK(b.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE( span )
+    {
+      using namespace Memory;
+      vector<string> tokens;
+      vector<size_t> sizes;
+      Buffer::Batch b([&](const Buffer::Batch &b) {
+          sizes.push_back(b.size());
+          for (size_t k = 0; k < b.size(); ++k)
+            tokens.emplace_back(b[k].first, b[k].second);
+        });
+      string x("ab cd"), y("ef gh ij"), z("kl");
+      {
+        const char *pe = x.data() + x.size();
+        Buffer::Resume r(b, x.data(), pe);
+        b.start(x.data());
+        b.finish(x.data() + 2);
+        b.start(x.data() + 3);
+      }
+      {
+        const char *pe = y.data() + y.size();
+        Buffer::Resume r(b, y.data(), pe);
+        b.finish(y.data() + 2);
+        b.start(y.data() + 3);
+        b.finish(y.data() + 5);
+        b.start(y.data() + 6);
+      }
+      {
+        const char *pe = z.data() + z.size();
+        Buffer::Resume r(b, z.data(), pe);
+      }
+      b.finish();
+      b.flush();
+      const vector<string> ref = { "ab", "cdef", "gh", "ijkl" };
+      BOOST_CHECK_EQUAL_COLLECTIONS(tokens.begin(), tokens.end(),
+          ref.begin(), ref.end());
+      const vector<size_t> ref_sizes = { 1, 2, 1 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(sizes.begin(), sizes.end(),
+          ref_sizes.begin(), ref_sizes.end());
+    }
+
+    BOOST_AUTO_TEST_CASE( max_tokens )
+    {
+      using namespace Memory;
+      vector<size_t> sizes;
+      Buffer::Batch b([&](const Buffer::Batch &b) {
+          sizes.push_back(b.size());
+        }, 2);
+      const char i[] = "a b c d e";
+      for (unsigned k = 0; k < 5; ++k) {
+        b.start(i + 2 * k);
+        b.finish(i + 2 * k + 1);
+      }
+      b.flush();
+      const vector<size_t> ref = { 2, 2, 1 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(sizes.begin(), sizes.end(),
+          ref.begin(), ref.end());
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
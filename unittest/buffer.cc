@@ -24,10 +24,16 @@ namespace fs = boost::filesystem;
 
 #include <buffer/buffer.h>
 #include <buffer/file.h>
+#include <buffer/small_vector.h>
 
 #include <array>
 #include <set>
 #include <fstream>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
 using namespace std;
 
 BOOST_AUTO_TEST_SUITE( buffer )
@@ -72,6 +78,101 @@ BOOST_AUTO_TEST_SUITE( buffer )
       }
     }
 
+    BOOST_AUTO_TEST_CASE( null )
+    {
+      using namespace Memory;
+      Buffer::Null n;
+      Buffer::Proxy p(&n);
+      const char inp[] = "foo";
+      {
+        const char *pe = inp + 1;
+        Buffer::Resume r(p, inp, pe);
+        p.start(inp);
+        // doesn't track the token
+        BOOST_CHECK(p.pending() == nullptr);
+      }
+      p.resume(inp + 1);
+      p.finish(inp + sizeof(inp) - 1);
+      p.finish();
+      p.clear();
+      n.start(inp);
+      n.stop(inp + 1);
+      n.cont(inp + 2);
+      BOOST_CHECK(n.pending() == nullptr);
+      BOOST_CHECK_NO_THROW(n.buffer_copy(inp, inp + 1, true));
+      // a 2nd last copy isn't an error, as it would be for a Vector
+      BOOST_CHECK_NO_THROW(n.buffer_copy(inp + 1, inp + 2, true));
+
+      // the default Proxy forwards to the null buffer ...
+      Buffer::Proxy q;
+      q.start(inp);
+      BOOST_CHECK(q.pending() == nullptr);
+      q.finish(inp + 3);
+      // ... unlike one with a target
+      Buffer::Vector v;
+      Buffer::Proxy w(&v);
+      w.start(inp);
+      BOOST_CHECK(w.pending() == inp);
+      w.finish(inp + 3);
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "foo");
+      // set(nullptr) switches back to the null buffer
+      w.set(nullptr);
+      w.start(inp + 1);
+      BOOST_CHECK(w.pending() == nullptr);
+      w.finish(inp + 2);
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "foo");
+    }
+
+    BOOST_AUTO_TEST_CASE( tee )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/tee";
+      fs::remove(filename);
+      fs::create_directory("tmp");
+      Buffer::Vector v;
+      {
+        Buffer::File f("tmp", "tee");
+        Buffer::Tee t { &v, &f };
+        BOOST_CHECK_EQUAL(t.size(), 2u);
+        const char inp[] = "foo barbaz";
+        const char *pe = inp + 4;
+        t.start(inp);
+        t.finish(inp + 3);
+        // located in one block: referenced
+        BOOST_CHECK(v.begin() == inp);
+        BOOST_CHECK(v.end() == inp + 3);
+        {
+          Buffer::Resume r(t, inp, pe);
+          t.start(inp + 4);
+          pe = inp + 7;
+          BOOST_CHECK(t.pending() == inp + 4);
+        }
+        const char *qe = inp + sizeof(inp) - 1;
+        {
+          Buffer::Resume r(t, pe, qe);
+          t.finish(qe);
+        }
+        BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "barbaz");
+      }
+      ifstream f(filename, ofstream::in | ofstream::binary);
+      array<char, 32> b = {{0}};
+      f.read(b.data(), b.size()-1);
+      BOOST_CHECK_EQUAL(b.data(), "foobarbaz");
+    }
+
+    BOOST_AUTO_TEST_CASE( tee_pending )
+    {
+      using namespace Memory;
+      Buffer::Vector v;
+      Buffer::Null n;
+      Buffer::Tee t { &v, &n };
+      const char inp[] = "foo";
+      t.start(inp);
+      // the Null child doesn't track the token
+      BOOST_CHECK(t.pending() == nullptr);
+      BOOST_CHECK_THROW(t.add(nullptr), std::logic_error);
+    }
+
   BOOST_AUTO_TEST_SUITE_END()
 
   BOOST_AUTO_TEST_SUITE( vector )
@@ -142,6 +243,106 @@ BOOST_AUTO_TEST_SUITE( buffer )
       BOOST_CHECK_EQUAL(s, inp);
     }
 
+#ifdef GMS_BUFFER_STATS
+    BOOST_AUTO_TEST_CASE( stats )
+    {
+      using namespace Memory;
+      Buffer::Vector v;
+      const char i[] = "foo barbaz";
+      v.start(i);
+      v.finish(i + 3);
+      {
+        const char *pe = i + 7;
+        Buffer::Resume r(v, i, pe);
+        v.start(i + 4);
+      }
+      {
+        const char *pe = i + sizeof(i) - 1;
+        Buffer::Resume r(v, i + 7, pe);
+        v.finish(pe);
+      }
+      const Buffer::Stats &s = v.stats();
+      BOOST_CHECK_EQUAL(s.tokens, 2u);
+      BOOST_CHECK_EQUAL(s.zero_copy, 1u);
+      BOOST_CHECK_EQUAL(s.spanning, 1u);
+      BOOST_CHECK_EQUAL(s.paused_bytes, 3u);
+      BOOST_CHECK_EQUAL(s.bytes_copied, 6u);
+      BOOST_CHECK(s.reallocations >= 1u);
+      BOOST_CHECK_EQUAL(s.token_length[Buffer::Histogram::bucket(3)], 1u);
+      BOOST_CHECK_EQUAL(s.token_length[Buffer::Histogram::bucket(6)], 1u);
+      BOOST_CHECK_EQUAL(s.blocks_per_token[Buffer::Histogram::bucket(2)], 1u);
+      v.clear_stats();
+      BOOST_CHECK_EQUAL(v.stats().tokens, 0u);
+    }
+#endif
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+  BOOST_AUTO_TEST_SUITE( small_vector )
+
+    BOOST_AUTO_TEST_CASE( lazy )
+    {
+      const char i[] = "Hello World!";
+      Memory::Buffer::Small_Vector<8> v;
+      v.start(i);
+      v.finish(i + sizeof(i) - 1);
+      BOOST_CHECK(v.begin() == i);
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), i);
+    }
+
+    BOOST_AUTO_TEST_CASE( inline_storage )
+    {
+      const char i[] = "Hello World!";
+      Memory::Buffer::Small_Vector<16> v;
+      {
+        const char *pe = i + 5;
+        Memory::Buffer::Resume r(v, i, pe);
+        v.start(i);
+      }
+      {
+        const char *pe = i + sizeof(i) - 1;
+        Memory::Buffer::Resume r(v, i + 5, pe);
+        v.finish(pe);
+      }
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), i);
+      BOOST_CHECK_EQUAL(v.size(), sizeof(i) - 1);
+      BOOST_CHECK(!v.on_heap());
+      BOOST_CHECK(v.begin() < i || v.begin() >= i + sizeof(i));
+    }
+
+    BOOST_AUTO_TEST_CASE( heap )
+    {
+      const char i[] = "Hello World!";
+      Memory::Buffer::Small_Vector<4> v;
+      v.start(i);
+      v.stop(i + 3);
+      BOOST_CHECK(!v.on_heap());
+      v.cont(i + 3);
+      v.stop(i + 7);
+      BOOST_CHECK(v.on_heap());
+      v.cont(i + 7);
+      v.finish(i + sizeof(i) - 1);
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), i);
+      Memory::Buffer::Small_Vector<4> w(std::move(v));
+      BOOST_CHECK(v.begin() == nullptr);
+      BOOST_CHECK_EQUAL(string(w.begin(), w.end()), i);
+    }
+
+    BOOST_AUTO_TEST_CASE( move_commit )
+    {
+      const char i[] = "xyz";
+      Memory::Buffer::Small_Vector<8> v;
+      Memory::Buffer::Small_Vector<8> w;
+      v.start(i);
+      v.finish(i + sizeof(i) - 1);
+      v.commit();
+      BOOST_CHECK(v.begin() != i);
+      w = std::move(v);
+      BOOST_CHECK(v.begin() == nullptr);
+      BOOST_CHECK(v.end() == nullptr);
+      BOOST_CHECK_EQUAL(string(w.begin(), w.end()), i);
+    }
+
   BOOST_AUTO_TEST_SUITE_END()
 
   BOOST_AUTO_TEST_SUITE( file  )
@@ -202,6 +403,108 @@ BOOST_AUTO_TEST_SUITE( buffer )
 
     }
 
+    BOOST_AUTO_TEST_CASE( buffered )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/buffered";
+      fs::remove(filename);
+      fs::create_directory("tmp");
+      string ref;
+      {
+        Buffer::File f("tmp", "buffered");
+        f.set_buffer_size(16);
+        const string small("abc");
+        const string large(100, 'x');
+        for (unsigned i = 0; i < 10; ++i) {
+          const string &s = i % 3 ? small : large;
+          f.start(s.data());
+          f.finish(s.data() + s.size());
+          ref += s;
+        }
+        Buffer::File g(std::move(f));
+        const char inp[] = "tail";
+        g.start(inp);
+        g.finish(inp + sizeof(inp) - 1);
+        ref += inp;
+      }
+      ifstream f(filename, ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK_EQUAL(s, ref);
+    }
+
+    BOOST_AUTO_TEST_CASE( direct )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/direct";
+      fs::remove(filename);
+      fs::create_directory("tmp");
+      string ref;
+      {
+        Buffer::File f("tmp", "direct", true, Buffer::File::DIRECT);
+        f.set_buffer_size(5000);
+        for (unsigned i = 0; i < 100; ++i) {
+          string s(i * 7 % 300, char('a' + i % 26));
+          f.start(s.data());
+          f.finish(s.data() + s.size());
+          ref += s;
+          if (i == 50)
+            f.flush();
+        }
+      }
+      BOOST_CHECK_EQUAL(fs::file_size(filename), ref.size());
+      ifstream f(filename, ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK(s == ref);
+    }
+
+    BOOST_AUTO_TEST_CASE( direct_reopen )
+    {
+      using namespace Memory;
+      fs::remove("tmp/direct_a");
+      fs::remove("tmp/direct_b");
+      fs::create_directory("tmp");
+      Buffer::File f;
+      f.set_buffer_size(1000);
+      f.open("tmp", "direct_a");
+      const string s(10, 'x');
+      f.start(s.data());
+      f.finish(s.data() + s.size());
+      f.close();
+      // the buffer of the first file is smaller than the rounded up one
+      f.open("tmp", "direct_b", true, Buffer::File::DIRECT);
+      const string t(3000, 'y');
+      f.start(t.data());
+      f.finish(t.data() + t.size());
+      f.close();
+      BOOST_CHECK_EQUAL(fs::file_size("tmp/direct_a"), s.size());
+      BOOST_CHECK_EQUAL(fs::file_size("tmp/direct_b"), t.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( writeback )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/writeback";
+      fs::remove(filename);
+      fs::create_directory("tmp");
+      string ref;
+      {
+        Buffer::File f("tmp", "writeback");
+        f.preallocate(1024 * 1024);
+        f.set_writeback(8192);
+        f.set_buffer_size(1000);
+        for (unsigned i = 0; i < 100; ++i) {
+          string s(i * 13 % 1500, char('a' + i % 26));
+          f.start(s.data());
+          f.finish(s.data() + s.size());
+          ref += s;
+        }
+      }
+      BOOST_CHECK_EQUAL(fs::file_size(filename), ref.size());
+      ifstream f(filename, ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK(s == ref);
+    }
+
     BOOST_AUTO_TEST_CASE( openat )
     {
       using namespace Memory;
@@ -230,6 +533,182 @@ BOOST_AUTO_TEST_SUITE( buffer )
 
     }
 
+    BOOST_AUTO_TEST_CASE( group_commit )
+    {
+      using namespace Memory;
+      const char path[] = "tmp/group_commit";
+      fs::remove_all(path);
+      fs::create_directories(path);
+      Dir d(path);
+      d.set_group_commit(true);
+      d.set_max_pending(4);
+      d.set_max_delay(std::chrono::milliseconds(60 * 1000));
+      uint64_t ticket = 0;
+      for (unsigned i = 0; i < 10; ++i) {
+        Buffer::File f(d, "f" + to_string(i));
+        const char inp[] = "hello";
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+        f.close();
+        ticket = f.ticket();
+      }
+      BOOST_CHECK_EQUAL(ticket, 10u);
+      BOOST_CHECK_EQUAL(d.commits(), 2u);
+      d.wait(ticket);
+      BOOST_CHECK_EQUAL(d.commits(), 3u);
+      d.wait(ticket);
+      BOOST_CHECK_EQUAL(d.commits(), 3u);
+      fs::directory_iterator begin(path), end;
+      BOOST_CHECK_EQUAL(std::distance(begin, end), 10);
+      BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/f9"), 5u);
+    }
+
+    BOOST_AUTO_TEST_CASE( atomic )
+    {
+      using namespace Memory;
+      const char path[] = "tmp/atomic";
+      fs::remove_all(path);
+      fs::create_directories(path);
+      const char inp[] = "hello";
+      {
+        Buffer::File f(path, "foo", true, Buffer::File::ATOMIC);
+        BOOST_CHECK(f.atomic());
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+        f.flush();
+        BOOST_CHECK(!fs::exists(string(path) + "/foo"));
+        f.close();
+        BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/foo"), 5u);
+      }
+      BOOST_CHECK_THROW(Buffer::File(path, "foo", true, Buffer::File::ATOMIC),
+          std::runtime_error);
+      {
+        Buffer::File f(path, "foo", false, Buffer::File::ATOMIC);
+        f.start(inp);
+        f.finish(inp + 2);
+        f.close();
+        BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/foo"), 2u);
+      }
+      Dir d(path);
+      d.set_group_commit(true);
+      d.set_max_delay(std::chrono::milliseconds(60 * 1000));
+      Buffer::File f(d, "bar", true, Buffer::File::ATOMIC);
+      f.start(inp);
+      f.finish(inp + sizeof(inp) - 1);
+      f.close();
+      BOOST_CHECK(!fs::exists(string(path) + "/bar"));
+      d.wait(f.ticket());
+      BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/bar"), 5u);
+      // no temporary files are left behind
+      fs::directory_iterator begin(path), end;
+      BOOST_CHECK_EQUAL(std::distance(begin, end), 2);
+    }
+
+    BOOST_AUTO_TEST_CASE( group_commit_poll )
+    {
+      using namespace Memory;
+      const char path[] = "tmp/group_poll";
+      fs::remove_all(path);
+      fs::create_directories(path);
+      const char inp[] = "hello";
+      Dir d(path);
+      d.set_group_commit(true);
+      d.set_max_delay(std::chrono::milliseconds(20));
+      {
+        Buffer::File f(d, "foo", true, Buffer::File::ATOMIC);
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+      }
+      d.poll();
+      BOOST_CHECK_EQUAL(d.commits(), 0u);
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      d.poll();
+      BOOST_CHECK_EQUAL(d.commits(), 1u);
+      BOOST_CHECK(fs::exists(string(path) + "/foo"));
+      {
+        Buffer::File f(d, "bar", true, Buffer::File::ATOMIC);
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+      }
+      // the pending file of the target is committed
+      d = Dir(path);
+      BOOST_CHECK(fs::exists(string(path) + "/bar"));
+    }
+
+    BOOST_AUTO_TEST_CASE( group_commit_publish )
+    {
+      using namespace Memory;
+      const char path[] = "tmp/group_publish";
+      fs::remove_all(path);
+      fs::create_directories(path);
+      Dir d(path);
+      d.set_group_commit(true);
+      d.set_max_delay(std::chrono::milliseconds(60 * 1000));
+      const char inp[] = "hello";
+      std::vector<uint64_t> tickets;
+      for (unsigned i = 0; i < 3; ++i) {
+        Buffer::File f(d, "f" + to_string(i), true, Buffer::File::ATOMIC);
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+        f.close();
+        tickets.push_back(f.ticket());
+      }
+      // the exclusive link of f0 fails
+      ofstream(string(path) + "/f0");
+      BOOST_CHECK_THROW(d.commit(), std::runtime_error);
+      BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/f0"), 0u);
+      BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/f1"), 5u);
+      BOOST_CHECK_EQUAL(fs::file_size(string(path) + "/f2"), 5u);
+      // the outcome is kept per file
+      BOOST_CHECK_THROW(d.wait(tickets[0]), std::runtime_error);
+      BOOST_CHECK_NO_THROW(d.wait(tickets[1]));
+      BOOST_CHECK_NO_THROW(d.wait(tickets[2]));
+      // a later successful batch doesn't hide the failure
+      {
+        Buffer::File f(d, "f3", true, Buffer::File::ATOMIC);
+        f.start(inp);
+        f.finish(inp + sizeof(inp) - 1);
+        f.close();
+        d.wait(f.ticket());
+      }
+      BOOST_CHECK_EQUAL(d.commits(), 2u);
+      BOOST_CHECK_THROW(d.wait(tickets[0]), std::runtime_error);
+    }
+
+    BOOST_AUTO_TEST_CASE( atomic_write_error )
+    {
+      using namespace Memory;
+      const char path[] = "tmp/atomic_error";
+      fs::remove_all(path);
+      fs::create_directories(path);
+      // writes beyond the limit fail with EFBIG
+      struct rlimit old;
+      getrlimit(RLIMIT_FSIZE, &old);
+      struct rlimit lim = old;
+      lim.rlim_cur = 4096;
+      setrlimit(RLIMIT_FSIZE, &lim);
+      auto sig = signal(SIGXFSZ, SIG_IGN);
+      const string s(3 * 4096, 'x');
+      {
+        Buffer::File f(path, "foo", true, Buffer::File::ATOMIC);
+        f.start(s.data());
+        f.finish(s.data() + s.size());
+        BOOST_CHECK_THROW(f.close(), std::runtime_error);
+        // the destructor doesn't publish the truncated file
+      }
+      {
+        Buffer::File f(path, "bar", true, Buffer::File::ATOMIC);
+        f.set_buffer_size(4096);
+        f.start(s.data());
+        BOOST_CHECK_THROW(f.finish(s.data() + s.size()), std::runtime_error);
+        BOOST_CHECK_THROW(f.close(), std::runtime_error);
+      }
+      setrlimit(RLIMIT_FSIZE, &old);
+      signal(SIGXFSZ, sig);
+      fs::directory_iterator begin(path), end;
+      BOOST_CHECK_EQUAL(std::distance(begin, end), 0);
+    }
+
   BOOST_AUTO_TEST_SUITE_END()
 
   BOOST_AUTO_TEST_SUITE( opportune )
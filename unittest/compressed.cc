@@ -0,0 +1,109 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/buffer.h>
+#include <buffer/compressed.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( compressed )
+
+    BOOST_AUTO_TEST_CASE( frames )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/compressed.gz";
+      fs::remove(filename);
+      fs::remove(string(filename) + ".idx");
+      fs::create_directory("tmp");
+      string ref;
+      {
+        Buffer::Compressed_File f("tmp", "compressed.gz",
+            Buffer::Compressed_File::ZLIB, 4096);
+        f.set_sync(false);
+        for (unsigned i = 0; i < 5000; ++i) {
+          string x("token " + to_string(i) + '\n');
+          const char *p = x.data();
+          const char *pe = p + x.size();
+          Buffer::Resume r(f, p, pe);
+          f.start(p);
+          f.finish(pe);
+          ref += x;
+        }
+        f.close();
+        BOOST_CHECK_EQUAL(f.frames(), (ref.size() + 4095) / 4096);
+      }
+
+      ifstream in(filename, ifstream::in | ifstream::binary);
+      string data((istreambuf_iterator<char>(in)),
+          istreambuf_iterator<char>());
+      BOOST_CHECK(data.size() < ref.size() / 2);
+
+      Buffer::Compressed_File::Codec codec;
+      auto index = Buffer::Compressed_File::read_index(
+          string(filename) + ".idx", &codec);
+      BOOST_CHECK(codec == Buffer::Compressed_File::ZLIB);
+      BOOST_REQUIRE_EQUAL(index.size(), (ref.size() + 4095) / 4096);
+      // each frame can be decompressed on its own
+      string out;
+      vector<char> v;
+      uint64_t off = 0;
+      for (auto &fr : index) {
+        BOOST_CHECK_EQUAL(fr.off, off);
+        BOOST_CHECK_EQUAL(fr.raw_off, out.size());
+        Buffer::Compressed_File::decompress(codec, fr, data.data() + fr.off,
+            v);
+        out.append(v.begin(), v.end());
+        off += fr.len;
+      }
+      BOOST_CHECK_EQUAL(off, data.size());
+      BOOST_CHECK(out == ref);
+
+      // little-endian, independent of the host: raw_len of the
+      // first frame is 4096
+      ifstream idx(string(filename) + ".idx", ifstream::in | ifstream::binary);
+      string x((istreambuf_iterator<char>(idx)), istreambuf_iterator<char>());
+      BOOST_REQUIRE(x.size() >= 8 + 32);
+      const char raw_len[8] = { 0, 0x10, 0, 0, 0, 0, 0, 0 };
+      BOOST_CHECK(x.compare(8 + 24, 8, raw_len, 8) == 0);
+    }
+
+    BOOST_AUTO_TEST_CASE( codecs )
+    {
+      using namespace Memory;
+      BOOST_CHECK(Buffer::Compressed_File::available(
+            Buffer::Compressed_File::ZLIB));
+      if (!Buffer::Compressed_File::available(Buffer::Compressed_File::LZ4))
+        BOOST_CHECK_THROW(Buffer::Compressed_File("tmp", "compressed.lz4",
+              Buffer::Compressed_File::LZ4), std::logic_error);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
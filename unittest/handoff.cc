@@ -0,0 +1,124 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/handoff.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( handoff )
+
+    BOOST_AUTO_TEST_CASE( ring )
+    {
+      Memory::Spsc_Ring<int> r(3);
+      BOOST_CHECK_EQUAL(r.capacity(), 4u);
+      for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(r.push(i));
+      BOOST_CHECK(!r.push(4));
+      int x = -1;
+      BOOST_CHECK(r.pop(x));
+      BOOST_CHECK_EQUAL(x, 0);
+      BOOST_CHECK(r.push(4));
+      for (int i = 1; i < 5; ++i) {
+        BOOST_CHECK(r.pop(x));
+        BOOST_CHECK_EQUAL(x, i);
+      }
+      BOOST_CHECK(r.empty());
+      BOOST_CHECK(!r.pop(x));
+    }
+
+    BOOST_AUTO_TEST_CASE( threads )
+    {
+      using namespace Memory;
+      vector<string> ref;
+      string s;
+      for (unsigned i = 0; i < 20000; ++i) {
+        ref.push_back(to_string(i));
+        s += ref.back();
+        s += ' ';
+      }
+      Handoff h(16);
+      thread producer([&h, &s]() {
+          Buffer::Base &b = h.buffer();
+          bool in = false;
+          // small blocks such that tokens span blocks
+          for (size_t off = 0; off < s.size(); off += 7) {
+            const char *p = s.data() + off;
+            const char *pe = s.data() + min(off + 7, s.size());
+            Buffer::Resume r(b, p, pe);
+            for (; p != pe; ++p) {
+              if (*p == ' ') {
+                if (in)
+                  b.finish(p);
+                in = false;
+              } else if (!in) {
+                b.start(p);
+                in = true;
+              }
+            }
+          }
+          h.close();
+        });
+      vector<string> tokens;
+      h.consume([&tokens](const Buffer::Vector &v) {
+          tokens.emplace_back(v.begin(), v.end());
+        });
+      producer.join();
+      BOOST_CHECK(h.done());
+      BOOST_CHECK_EQUAL_COLLECTIONS(tokens.begin(), tokens.end(),
+          ref.begin(), ref.end());
+      Handoff::Stats st = h.stats();
+      BOOST_CHECK_EQUAL(st.tokens, ref.size());
+      // Vectors are recycled
+      BOOST_CHECK(st.allocations <= 16u + 2u + 1u);
+      BOOST_CHECK(st.latency_max_ns * st.tokens >= st.latency_sum_ns);
+    }
+
+    BOOST_AUTO_TEST_CASE( abandon )
+    {
+      using namespace Memory;
+      Handoff h;
+      Buffer::Base &b = h.buffer();
+      const char inp[] = "abc def";
+      b.start(inp);
+      // copies the prefix of the token
+      b.pause(inp + 2);
+      b.resume(inp);
+      // the lexer abandons the token and starts a new one
+      b.start(inp + 4);
+      b.finish(inp + 7);
+      h.close();
+      Buffer::Vector *v = h.pop();
+      BOOST_REQUIRE(v);
+      BOOST_CHECK_EQUAL(string(v->begin(), v->end()), "def");
+      h.recycle(v);
+      BOOST_CHECK(h.done());
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
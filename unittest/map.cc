@@ -0,0 +1,108 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/map.h>
+#include "word_lexer.h"
+
+#include <string>
+#include <vector>
+using namespace std;
+
+using namespace Test;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( map )
+
+    BOOST_AUTO_TEST_CASE( whole )
+    {
+      string s("ab cdef gh ijklm n opq rstu vw xyz 0123 4 56789");
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/map", s);
+      Memory::Map_Reader r(v, inp.fd);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      // the last word is completed via finish() after the end of file
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size() - 1);
+      BOOST_CHECK_EQUAL(r.windows(), 1u);
+      BOOST_CHECK_EQUAL(r.size(), s.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( empty )
+    {
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/map", "");
+      Memory::Map_Reader r(v, inp.fd);
+      BOOST_CHECK_EQUAL(r.next([&l](const char *p, const char *pe) {
+            l(p, pe); }), false);
+      BOOST_CHECK(l.words.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE( windows )
+    {
+      string s;
+      for (unsigned i = 0; i < 1000; ++i)
+        s += "abcdefghijklmnopqrstuvwxyz" + to_string(i) + ' ';
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/map", s);
+      Memory::Map_Reader r(v, inp.fd);
+      r.set_budget(4096);
+      r.set_window(4096);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK(r.windows() > 1);
+      // words that cross windows are still contiguous
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( overlong )
+    {
+      string s("ab ");
+      s += string(10000, 'x');
+      s += " cd ";
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/map", s);
+      Memory::Map_Reader r(v, inp.fd);
+      r.set_budget(4096);
+      r.set_window(4096);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size() - 1);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/parallel.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+  // space separated words, newline separated records
+  void lex(Memory::Buffer::Base &b, const char *p, const char *pe)
+  {
+    bool in = false;
+    for (; p != pe; ++p) {
+      if (*p == ' ' || *p == '\n') {
+        if (in)
+          b.finish(p);
+        in = false;
+      } else if (!in) {
+        b.start(p);
+        in = true;
+      }
+    }
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( parallel )
+
+    BOOST_AUTO_TEST_CASE( order )
+    {
+      using namespace Memory;
+      string s;
+      vector<string> ref;
+      for (unsigned i = 0; i < 1000; ++i) {
+        for (unsigned k = 0; k < i % 5; ++k) {
+          ref.push_back(to_string(i) + "_" + to_string(k));
+          s += ref.back();
+          s += k + 1 < i % 5 ? " " : "";
+        }
+        s += '\n';
+      }
+      // last record without newline
+      s += "x y";
+      ref.push_back("x");
+      ref.push_back("y");
+
+      for (unsigned threads : { 1u, 3u, 8u }) {
+        Parallel par(threads);
+        BOOST_CHECK_EQUAL(par.threads(), threads);
+        vector<string> tokens;
+        const char *begin = s.data();
+        par.run(begin, begin + s.size(), Parallel::newline, lex,
+            [&tokens, begin, &s](const char *b, const char *e) {
+              // referenced, not copied
+              BOOST_CHECK(b >= begin && e <= begin + s.size());
+              tokens.emplace_back(b, e);
+            });
+        BOOST_CHECK_EQUAL_COLLECTIONS(tokens.begin(), tokens.end(),
+            ref.begin(), ref.end());
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE( window )
+    {
+      using namespace Memory;
+      string s;
+      vector<string> ref;
+      for (unsigned i = 0; i < 10000; ++i) {
+        ref.push_back(to_string(i));
+        s += ref.back();
+        s += i % 7 ? ' ' : '\n';
+      }
+      // many more chunks than slots
+      Parallel par(3);
+      par.set_chunk_size(64);
+      BOOST_CHECK_THROW(par.set_chunk_size(0), std::logic_error);
+      vector<string> tokens;
+      par.run(s.data(), s.data() + s.size(), Parallel::newline, lex,
+          [&tokens](const char *b, const char *e) {
+            tokens.emplace_back(b, e);
+          });
+      BOOST_CHECK_EQUAL_COLLECTIONS(tokens.begin(), tokens.end(),
+          ref.begin(), ref.end());
+      // an error of the emit function stops the workers
+      size_t k = 0;
+      BOOST_CHECK_THROW(par.run(s.data(), s.data() + s.size(),
+            Parallel::newline, lex, [&k](const char *, const char *) {
+              if (++k == 1000)
+                throw std::runtime_error("emit");
+            }), std::runtime_error);
+    }
+
+    BOOST_AUTO_TEST_CASE( tiny )
+    {
+      using namespace Memory;
+      Parallel par(8);
+      vector<string> tokens;
+      string s("a b");
+      par.run(s.data(), s.data() + s.size(), Parallel::newline, lex,
+          [&tokens](const char *b, const char *e) {
+            tokens.emplace_back(b, e);
+          });
+      const vector<string> ref = { "a", "b" };
+      BOOST_CHECK_EQUAL_COLLECTIONS(tokens.begin(), tokens.end(),
+          ref.begin(), ref.end());
+      tokens.clear();
+      par.run(s.data(), s.data(), Parallel::newline, lex,
+          [&tokens](const char *b, const char *e) {
+            tokens.emplace_back(b, e);
+          });
+      BOOST_CHECK(tokens.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE( bad_sync )
+    {
+      using namespace Memory;
+      Parallel par(4);
+      string s(4096, 'a');
+      for (size_t i = 0; i < s.size(); i += 100)
+        s[i] = '\n';
+      // splits in the middle of the words
+      auto sync = [](const char *p, const char *) { return p; };
+      BOOST_CHECK_THROW(par.run(s.data(), s.data() + s.size(), sync, lex,
+            [](const char *, const char *) {}), std::logic_error);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/reader.h>
+#include "word_lexer.h"
+
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+  using namespace Test;
+
+  void lex(const string &content, size_t block, size_t max_block, bool huge,
+      Word_Lexer &l)
+  {
+    Input inp("tmp/reader", content);
+    Memory::Reader r(l.v, inp.fd, block);
+    r.set_max_block(max_block);
+    r.set_huge_pages(huge);
+    r.run([&l](const char *p, const char *pe) { l(p, pe); });
+    l.eof();
+    BOOST_CHECK_EQUAL(r.next([](const char *, const char *) {}), false);
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( reader )
+
+    BOOST_AUTO_TEST_CASE( zero_copy )
+    {
+      string s("ab cdef gh ijklm n opq rstu vw xyz 0123 4 56789 ");
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      lex(s, 8, 8, false, l);
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      // each word fits into the buffer, thus it is always moved
+      // in front of the next block
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( overlong )
+    {
+      string s("ab abcdefghijklmnopqrstuvwxyz0123456789 cd ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      lex(s, 4, 4, false, l);
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK(l.zero_copy < ref.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( adapt )
+    {
+      string s;
+      for (unsigned i = 0; i < 1000; ++i)
+        s += "abcdefghijklmnopqrstuvwxyz ";
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/reader", s);
+      Memory::Reader r(v, inp.fd, 16);
+      r.set_max_block(1024);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      BOOST_CHECK_EQUAL(l.words.size(), 1000u);
+      BOOST_CHECK_EQUAL(l.zero_copy, 1000u);
+      BOOST_CHECK(r.block_size() > 16);
+      BOOST_CHECK(r.block_size() <= 1024);
+      BOOST_CHECK(r.spans() <= r.blocks());
+    }
+
+    BOOST_AUTO_TEST_CASE( capped_growth )
+    {
+      // max_block isn't a power-of-two multiple of block, thus
+      // the grown buffer can't hold the spanning token
+      string s(12, ' ');
+      s += string(40, 'x');
+      s += " ab cdefghijklmnopqrstuvw ";
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      lex(s, 16, 17, false, l);
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+    }
+
+    BOOST_AUTO_TEST_CASE( huge_pages )
+    {
+      string s("Hello World, a huge page backed buffer");
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      lex(s, 4096, 4096, true, l);
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/ring.h>
+#include "word_lexer.h"
+
+#include <string>
+#include <vector>
+using namespace std;
+
+using namespace Test;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( ring )
+
+    BOOST_AUTO_TEST_CASE( wrap )
+    {
+      string s;
+      for (unsigned i = 0; i < 1000; ++i)
+        s += "abcdefghijklmnopqrstuvwxyz" + to_string(i) + ' ';
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/ring", s);
+      Memory::Ring_Reader r(v, inp.fd, 4096);
+      r.set_block(1000);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      // also the words that wrap around the end of the ring
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size());
+      BOOST_CHECK_EQUAL(r.copies(), 0u);
+    }
+
+    BOOST_AUTO_TEST_CASE( overrun )
+    {
+      string s("ab ");
+      s += string(10000, 'x');
+      s += " cd ef";
+      Memory::Buffer::Vector v;
+      Word_Lexer l(v);
+      Input inp("tmp/ring", s);
+      Memory::Ring_Reader r(v, inp.fd, 4096);
+      r.run([&l](const char *p, const char *pe) { l(p, pe); });
+      l.eof();
+      vector<string> ref(split(s));
+      BOOST_CHECK_EQUAL_COLLECTIONS(l.words.begin(), l.words.end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK(r.copies() > 0);
+      BOOST_CHECK_EQUAL(l.zero_copy, ref.size() - 2);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
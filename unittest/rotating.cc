@@ -0,0 +1,111 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+#include <buffer/rotating.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( rotating )
+
+    BOOST_AUTO_TEST_CASE( size )
+    {
+      using namespace Memory;
+      const char dir[] = "tmp/rotating";
+      fs::remove_all(dir);
+      fs::create_directories(dir);
+      string ref;
+      {
+        Dir d(dir);
+        Buffer::Rotating_File f(d, "cap", 1000);
+        BOOST_CHECK_EQUAL(f.filename(), "cap.000000");
+        string x(49, 'x');
+        for (unsigned i = 0; i < 100; ++i) {
+          string y(x);
+          y += char('a' + i % 26);
+          const char *p = y.data();
+          const char *pe = p + 25;
+          const char *qe = p + y.size();
+          {
+            Buffer::Resume r(f, p, pe);
+            f.start(p);
+          }
+          {
+            Buffer::Resume r(f, pe, qe);
+            f.finish(qe);
+          }
+          ref += y;
+        }
+        BOOST_CHECK_EQUAL(f.files(), 5u);
+        f.close();
+      }
+      string out;
+      for (unsigned i = 0; i < 5; ++i) {
+        string fn(string(dir) + "/"
+            + Buffer::Rotating_File::filename("cap", i));
+        BOOST_REQUIRE(fs::exists(fn));
+        ifstream in(fn, ifstream::in | ifstream::binary);
+        string data((istreambuf_iterator<char>(in)),
+            istreambuf_iterator<char>());
+        // switched at token boundaries
+        BOOST_CHECK_EQUAL(data.size(), 1000u);
+        out += data;
+      }
+      BOOST_CHECK(out == ref);
+      // the pre-created file is removed
+      BOOST_CHECK(!fs::exists(string(dir) + "/"
+            + Buffer::Rotating_File::filename("cap", 5)));
+    }
+
+    BOOST_AUTO_TEST_CASE( age )
+    {
+      using namespace Memory;
+      const char dir[] = "tmp/rotating_age";
+      fs::remove_all(dir);
+      fs::create_directories(dir);
+      Dir d(dir);
+      Buffer::Rotating_File f(d, "cap", 0, chrono::milliseconds(1));
+      f.set_sync(false);
+      const char i[] = "foo";
+      f.start(i);
+      f.finish(i + 3);
+      this_thread::sleep_for(chrono::milliseconds(5));
+      f.start(i);
+      f.finish(i + 3);
+      BOOST_CHECK_EQUAL(f.files(), 2u);
+      f.close();
+      BOOST_CHECK_EQUAL(fs::file_size(string(dir) + "/cap.000000"), 3u);
+      BOOST_CHECK_EQUAL(fs::file_size(string(dir) + "/cap.000001"), 3u);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
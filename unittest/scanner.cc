@@ -0,0 +1,150 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/scanner.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+namespace {
+
+  vector<pair<string, char> > split(const string &s, const string &delims)
+  {
+    vector<pair<string, char> > r;
+    size_t i = 0;
+    for (;;) {
+      size_t j = s.find_first_of(delims, i);
+      if (j == string::npos) {
+        r.emplace_back(s.substr(i), '\0');
+        return r;
+      }
+      r.emplace_back(s.substr(i, j - i), s[j]);
+      i = j + 1;
+    }
+  }
+
+  vector<pair<string, char> > scan(const string &s, const string &delims,
+      Memory::Scanner::Kernel k, size_t block)
+  {
+    using namespace Memory;
+    vector<pair<string, char> > r;
+    Buffer::Vector v;
+    Scanner sc(delims, k);
+    for (size_t i = 0; i < s.size(); i += block) {
+      const char *p = s.data() + i;
+      const char *pe = s.data() + min(s.size(), i + block);
+      Buffer::Resume res(v, p, pe);
+      sc.scan(v, p, pe, [&r, &v](char c) {
+          r.emplace_back(string(v.begin(), v.end()), c);
+        });
+    }
+    v.finish();
+    r.emplace_back(string(v.begin(), v.end()), '\0');
+    return r;
+  }
+
+  string input()
+  {
+    string s;
+    for (unsigned i = 0; i < 200; ++i) {
+      s += string(i * 7 % 61, char('a' + i % 26));
+      s += ",;\n="[i % 4];
+    }
+    s += "tail";
+    return s;
+  }
+
+  // the kernel is selected during static initialization
+  const Memory::Scanner static_scanner(",");
+
+}
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( scanner )
+
+    BOOST_AUTO_TEST_CASE( kernels )
+    {
+      using namespace Memory;
+      const string delims(",;\n");
+      string s(input());
+      auto ref = split(s, delims);
+      const Scanner::Kernel kernels[] = {
+        Scanner::SCALAR, Scanner::SSE2, Scanner::AVX2, Scanner::AUTO };
+      for (auto k : kernels) {
+        try {
+          Scanner sc(delims, k);
+        } catch (const runtime_error &) {
+          BOOST_TEST_MESSAGE("kernel " << k << " not supported");
+          continue;
+        }
+        for (size_t block : { size_t(7), size_t(64), s.size() }) {
+          auto r = scan(s, delims, k, block);
+          BOOST_REQUIRE_EQUAL(r.size(), ref.size());
+          for (size_t i = 0; i < r.size(); ++i) {
+            BOOST_CHECK_EQUAL(r[i].first, ref[i].first);
+            BOOST_CHECK_EQUAL(r[i].second, ref[i].second);
+          }
+        }
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE( find )
+    {
+      using namespace Memory;
+      string s(100, 'x');
+      s[77] = '|';
+      Scanner sc("|");
+      BOOST_CHECK(sc.find(s.data(), s.data() + s.size()) == s.data() + 77);
+      BOOST_CHECK(sc.find(s.data(), s.data() + 77) == s.data() + 77);
+      BOOST_CHECK(sc.find(s.data() + 78, s.data() + s.size())
+          == s.data() + s.size());
+    }
+
+    BOOST_AUTO_TEST_CASE( delimiters )
+    {
+      using namespace Memory;
+      BOOST_CHECK_THROW(Scanner(""), logic_error);
+      BOOST_CHECK_THROW(Scanner(string(17, ',') + "abcdefghijklmnopq"),
+          logic_error);
+    }
+
+    BOOST_AUTO_TEST_CASE( static_init )
+    {
+      using namespace Memory;
+      BOOST_CHECK_EQUAL(static_scanner.kernel(), Scanner(",").kernel());
+      // all 16 delimiter vectors are compared
+      const string delims("abcdefghijklmnop");
+      string s(100, 'x');
+      s[50] = 'p';
+      for (auto k : { Scanner::SCALAR, Scanner::AUTO }) {
+        Scanner sc(delims, k);
+        BOOST_CHECK(sc.find(s.data(), s.data() + s.size()) == s.data() + 50);
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,198 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/segmented.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( segmented )
+
+    BOOST_AUTO_TEST_CASE( leased )
+    {
+      using namespace Memory;
+      const char *inp[] = { "Hello", " World", "!" };
+      Block_Pool pool(16);
+      Buffer::Segmented s;
+      const char *blocks[3] = { nullptr };
+      for (unsigned i = 0; i < 3; ++i) {
+        shared_ptr<char> b(pool.get());
+        blocks[i] = b.get();
+        size_t n = strlen(inp[i]);
+        memcpy(b.get(), inp[i], n);
+        s.set_lease(b);
+        const char *pe = b.get() + n;
+        Buffer::Resume r(s, b.get(), pe);
+        if (!i)
+          s.start(b.get());
+        if (i == 2)
+          s.finish(pe);
+      }
+      s.set_lease(nullptr);
+      BOOST_CHECK_EQUAL(pool.size(), 3u);
+      BOOST_REQUIRE_EQUAL(s.iovcnt(), 3);
+      for (unsigned i = 0; i < 3; ++i)
+        BOOST_CHECK(s.iov()[i].iov_base == blocks[i]);
+      BOOST_CHECK_EQUAL(s.size(), 12u);
+      auto r = s.contiguous();
+      BOOST_CHECK_EQUAL(string(r.first, r.second), "Hello World!");
+
+      // the token pins the blocks
+      shared_ptr<char> b(pool.get());
+      BOOST_CHECK_EQUAL(pool.size(), 4u);
+      b.reset();
+      s.clear();
+      b = pool.get();
+      BOOST_CHECK_EQUAL(pool.size(), 4u);
+    }
+
+    BOOST_AUTO_TEST_CASE( unleased )
+    {
+      using namespace Memory;
+      const char i[] = "Hello World!";
+      Buffer::Segmented s;
+      {
+        const char *pe = i + 5;
+        Buffer::Resume r(s, i, pe);
+        s.start(i);
+      }
+      {
+        const char *pe = i + sizeof(i) - 1;
+        Buffer::Resume r(s, i + 5, pe);
+        s.finish(pe);
+      }
+      BOOST_REQUIRE_EQUAL(s.iovcnt(), 2);
+      // copied
+      BOOST_CHECK(s.iov()[0].iov_base != i);
+      // referenced, like Vector::range()
+      BOOST_CHECK(s.iov()[1].iov_base == i + 5);
+      auto r = s.contiguous();
+      BOOST_CHECK_EQUAL(string(r.first, r.second), i);
+    }
+
+    BOOST_AUTO_TEST_CASE( arena )
+    {
+      using namespace Memory;
+      const char i[] = "Hello World!";
+      Buffer::Segmented s;
+      const char *first = nullptr;
+      for (unsigned k = 0; k < 3; ++k) {
+        for (unsigned j = 0; j < 3; ++j) {
+          const char *p = i + 4 * j;
+          const char *pe = p + 4;
+          Buffer::Resume r(s, p, pe);
+          if (!j)
+            s.start(p);
+          if (j == 2)
+            s.finish(pe);
+        }
+        // the copied parts are adjacent in the arena
+        BOOST_REQUIRE_EQUAL(s.iovcnt(), 2);
+        BOOST_CHECK_EQUAL(s.iov()[0].iov_len, 8u);
+        // and the arena is reused for the next token
+        if (!k)
+          first = static_cast<const char*>(s.iov()[0].iov_base);
+        BOOST_CHECK(s.iov()[0].iov_base == first);
+        auto r = s.contiguous();
+        BOOST_CHECK_EQUAL(string(r.first, r.second), i);
+      }
+    }
+
+    BOOST_AUTO_TEST_CASE( stale_lease )
+    {
+      using namespace Memory;
+      const char i[] = "Hello World!";
+      Buffer::Segmented s;
+      s.set_lease(make_shared<int>(0));
+      {
+        const char *pe = i + 5;
+        Buffer::Resume r(s, i, pe);
+      }
+      // the lease doesn't cover the next block
+      {
+        const char *pe = i + 5;
+        Buffer::Resume r(s, i, pe);
+        s.start(i);
+      }
+      {
+        const char *pe = i + sizeof(i) - 1;
+        Buffer::Resume r(s, i + 5, pe);
+        s.finish(pe);
+      }
+      BOOST_REQUIRE_EQUAL(s.iovcnt(), 2);
+      BOOST_CHECK(s.iov()[0].iov_base != i);
+    }
+
+    BOOST_AUTO_TEST_CASE( write )
+    {
+      using namespace Memory;
+      // more segments than IOV_MAX
+      string x;
+      for (unsigned i = 0; i < 3000; ++i)
+        x += char('a' + i % 26);
+      shared_ptr<int> lease(make_shared<int>(0));
+      Buffer::Segmented s;
+      for (size_t i = 0; i < x.size(); ++i) {
+        s.set_lease(lease);
+        const char *p = x.data() + i;
+        const char *pe = p + 1;
+        Buffer::Resume r(s, p, pe);
+        if (!i)
+          s.start(p);
+        if (i + 1 == x.size())
+          s.finish(pe);
+      }
+      BOOST_REQUIRE_EQUAL(s.iovcnt(), 3000);
+      int fds[2];
+      BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+      s.write(fds[1]);
+      close(fds[1]);
+      string y(x.size() + 1, '\0');
+      size_t n = 0;
+      for (ssize_t r; (r = read(fds[0], &y[n], y.size() - n)) > 0; )
+        n += r;
+      close(fds[0]);
+      y.resize(n);
+      BOOST_CHECK(y == x);
+    }
+
+    BOOST_AUTO_TEST_CASE( single )
+    {
+      using namespace Memory;
+      const char i[] = "xyz";
+      Buffer::Segmented s;
+      s.start(i);
+      s.finish(i + 3);
+      auto r = s.contiguous();
+      BOOST_CHECK(r.first == i);
+      BOOST_CHECK(r.second == i + 3);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
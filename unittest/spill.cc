@@ -0,0 +1,99 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/buffer.h>
+#include <buffer/spill.h>
+
+#include <string>
+using namespace std;
+
+namespace {
+
+  // token spanning many blocks
+  string feed(Memory::Buffer::Spill &s, size_t blocks, size_t block)
+  {
+    using namespace Memory;
+    string ref;
+    for (size_t i = 0; i < blocks; ++i) {
+      string x(block, 'a' + i % 26);
+      const char *p = x.data();
+      const char *pe = p + x.size();
+      Buffer::Resume r(s, p, pe);
+      if (!i)
+        s.start(p);
+      ref += x;
+    }
+    s.finish();
+    return ref;
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( spill )
+
+    BOOST_AUTO_TEST_CASE( lazy )
+    {
+      using namespace Memory;
+      Buffer::Spill s(16);
+      const char i[] = "Hello World, no spill";
+      s.start(i);
+      s.finish(i + sizeof(i) - 1);
+      BOOST_CHECK(!s.spilled());
+      BOOST_CHECK(s.range().first == i);
+      BOOST_CHECK_EQUAL(s.size(), sizeof(i) - 1);
+    }
+
+    BOOST_AUTO_TEST_CASE( file )
+    {
+      using namespace Memory;
+      fs::create_directory("tmp");
+      for (const char *dir : { "tmp", "" }) {
+        Buffer::Spill s(1024);
+        s.set_dir(dir);
+        string ref = feed(s, 10, 500);
+        BOOST_CHECK(s.spilled());
+        BOOST_CHECK_EQUAL(s.size(), ref.size());
+        auto r = s.range();
+        BOOST_CHECK_EQUAL(string(r.first, r.second), ref);
+        char b[100];
+        BOOST_CHECK_EQUAL(s.read(4990, b, sizeof b), 10u);
+        BOOST_CHECK_EQUAL(string(b, b + 10), ref.substr(4990));
+
+        // the file is reused, small tokens stay in memory
+        string small = feed(s, 2, 100);
+        BOOST_CHECK(!s.spilled());
+        r = s.range();
+        BOOST_CHECK_EQUAL(string(r.first, r.second), small);
+        ref = feed(s, 4, 400);
+        BOOST_CHECK(s.spilled());
+        r = s.range();
+        BOOST_CHECK_EQUAL(string(r.first, r.second), ref);
+      }
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
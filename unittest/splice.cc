@@ -0,0 +1,152 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/buffer.h>
+#include <buffer/file.h>
+#include <buffer/splice.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+namespace {
+
+  // lexes "<length>:<payload>" records, forwards the payloads
+  // into the file - with resume, the first payload byte is read
+  // with the header and the token is finished at the next block
+  string passthrough(int in, int out, const string &filename,
+      bool resume = false)
+  {
+    using namespace Memory;
+    {
+      ofstream f(filename);
+    }
+    {
+      string inp;
+      for (unsigned i = 1; i < 20; ++i) {
+        string payload(i * 997, char('a' + i));
+        inp += to_string(payload.size()) + ':' + payload;
+      }
+      size_t k = 0;
+      while (k < inp.size()) {
+        ssize_t r = write(out, inp.data() + k, inp.size() - k);
+        BOOST_REQUIRE(r > 0);
+        k += r;
+      }
+      close(out);
+    }
+    string ref;
+    Buffer::File f("tmp", fs::path(filename).filename().string(), false);
+    Splice s(in);
+    for (;;) {
+      char b[16] = {0};
+      size_t n = s.peek(b, sizeof b);
+      if (!n)
+        break;
+      const char *colon = static_cast<const char*>(memchr(b, ':', n));
+      const char *begin = b;
+      BOOST_REQUIRE(colon);
+      size_t len = stoul(string(begin, colon));
+      size_t k = colon - b + 1;
+      if (resume) {
+        BOOST_REQUIRE_EQUAL(s.read(b, k + 1), k + 1);
+        const char *pe = b + k + 1;
+        Buffer::Resume r(f, b, pe);
+        f.finish(b);
+        f.start(b + k);
+        BOOST_CHECK_THROW(s.forward(f, len - 1), logic_error);
+        s.forward(f, pe, len - 1);
+        ref += string(len, char('a' + len / 997));
+        continue;
+      }
+      BOOST_REQUIRE_EQUAL(s.read(b, k), k);
+      // forward the first byte via the buffer, the rest
+      // via splice
+      char c = 0;
+      BOOST_REQUIRE_EQUAL(s.read(&c, 1), 1u);
+      f.start(&c);
+      f.stop(&c + 1);
+      s.forward(f, len - 1);
+      ref += string(len, char('a' + len / 997));
+    }
+    f.finish();
+    f.close();
+    return ref;
+  }
+
+}
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( splice )
+
+    BOOST_AUTO_TEST_CASE( pipe_input )
+    {
+      fs::create_directory("tmp");
+      int p[2];
+      BOOST_REQUIRE(pipe(p) == 0);
+      BOOST_REQUIRE(fcntl(p[1], F_SETPIPE_SZ, 1024 * 1024) != -1);
+      string ref(passthrough(p[0], p[1], "tmp/splice_pipe"));
+      close(p[0]);
+      ifstream f("tmp/splice_pipe", ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK(s == ref);
+    }
+
+    BOOST_AUTO_TEST_CASE( socket_input )
+    {
+      fs::create_directory("tmp");
+      int p[2];
+      BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, p) == 0);
+      int n = 1024 * 1024;
+      setsockopt(p[1], SOL_SOCKET, SO_SNDBUF, &n, sizeof n);
+      setsockopt(p[0], SOL_SOCKET, SO_RCVBUF, &n, sizeof n);
+      string ref(passthrough(p[0], p[1], "tmp/splice_socket"));
+      close(p[0]);
+      ifstream f("tmp/splice_socket", ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK(s == ref);
+    }
+
+    BOOST_AUTO_TEST_CASE( resume )
+    {
+      fs::create_directory("tmp");
+      int p[2];
+      BOOST_REQUIRE(pipe(p) == 0);
+      BOOST_REQUIRE(fcntl(p[1], F_SETPIPE_SZ, 1024 * 1024) != -1);
+      string ref(passthrough(p[0], p[1], "tmp/splice_resume", true));
+      close(p[0]);
+      ifstream f("tmp/splice_resume", ofstream::in | ofstream::binary);
+      string s((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+      BOOST_CHECK(s == ref);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
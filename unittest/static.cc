@@ -0,0 +1,209 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/static.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( static_ )
+
+    BOOST_AUTO_TEST_CASE( lazy )
+    {
+      const char i[] = "Hello World!";
+      pair<const char*, const char*> inp(i, i+sizeof(i)-1);
+      Memory::Buffer::Static::Vector v;
+      v.start(inp.first);
+      v.finish(inp.second);
+      string s(v.begin(), v.end());
+      BOOST_CHECK_EQUAL(s, "Hello World!");
+      BOOST_CHECK(v.begin() == inp.first);
+      BOOST_CHECK(v.end()   == inp.second);
+    }
+
+    BOOST_AUTO_TEST_CASE( resume )
+    {
+      using namespace Memory::Buffer;
+      const char i[] = "Hello World!";
+      pair<const char*, const char*> inp(i, i+sizeof(i)-1);
+      Static::Vector v;
+      {
+        const char *pe = inp.first+5;
+        Static::Resume<Static::Vector> r(v, inp.first, pe);
+        v.cont(inp.first);
+      }
+      {
+        Static::Resume<Static::Vector> r(v, inp.first+5, inp.second);
+        v.finish(inp.second);
+      }
+      string s(v.begin(), v.end());
+      BOOST_CHECK_EQUAL(s, "Hello World!");
+      BOOST_CHECK(    (v.begin() < inp.first && v.end() <= inp.first)
+                   || (v.begin() >= inp.second && v.end() >= inp.second) );
+    }
+
+    BOOST_AUTO_TEST_CASE( move )
+    {
+      using namespace Memory;
+      Buffer::Static::Vector v;
+      const char inp[] = "xyz";
+      v.start(inp);
+      v.finish(inp+sizeof(inp)-1);
+      v.commit();
+      Buffer::Static::Vector w(std::move(v));
+      BOOST_CHECK(v.begin() == nullptr);
+      BOOST_CHECK(v.end() == nullptr);
+      string t(w.begin(), w.end());
+      BOOST_CHECK_EQUAL(t, inp);
+    }
+
+    BOOST_AUTO_TEST_CASE( adapter )
+    {
+      using namespace Memory;
+      Buffer::Static::Vector v;
+      Buffer::Static::Adapter<Buffer::Static::Vector> a(v);
+      Buffer::Proxy p;
+      p.set(&a);
+      const char inp[] = "foo";
+      p.start(inp);
+      p.finish(inp + strlen(inp));
+      string s(v.begin(), v.end());
+      BOOST_CHECK_EQUAL(s, inp);
+      BOOST_CHECK(v.begin() == inp);
+    }
+
+    BOOST_AUTO_TEST_CASE( proxy )
+    {
+      using namespace Memory::Buffer;
+      Static::Vector v;
+      Static::Vector w;
+      Static::Null n;
+      Static::Proxy<Static::Vector, Static::Null> p;
+      const char *inp[] = {
+        "ign1",
+        "foo",
+        "ign2",
+        "bar",
+        "ign3"
+      };
+      p.start(inp[0]);
+      p.finish(inp[0] + strlen(inp[0]));
+      p.set(&v);
+      p.start(inp[1]);
+      p.finish(inp[1] + strlen(inp[1]));
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), inp[1]);
+      p.set(nullptr);
+      p.start(inp[2]);
+      p.finish(inp[2] + strlen(inp[2]));
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), inp[1]);
+      p.set(&w);
+      p.start(inp[3]);
+      p.finish(inp[3] + strlen(inp[3]));
+      BOOST_CHECK_EQUAL(string(w.begin(), w.end()), inp[3]);
+      p.set(&n);
+      p.start(inp[4]);
+      p.finish(inp[4] + strlen(inp[4]));
+      BOOST_CHECK_EQUAL(string(w.begin(), w.end()), inp[3]);
+    }
+
+    BOOST_AUTO_TEST_CASE( proxy_resume )
+    {
+      using namespace Memory::Buffer;
+      const char i[] = "Hello World!";
+      const char *mid = i + 5;
+      const char *end = i + sizeof(i) - 1;
+      Static::Vector v;
+      Static::Proxy<Static::Vector> p(&v);
+      {
+        Static::Resume<Static::Proxy<Static::Vector> > r(p, i, mid);
+        p.start(i);
+      }
+      {
+        Static::Resume<Static::Proxy<Static::Vector> > r(p, mid, end);
+        p.finish(end);
+      }
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), i);
+    }
+
+    BOOST_AUTO_TEST_CASE( tee )
+    {
+      using namespace Memory::Buffer;
+      const char i[] = "Hello World!";
+      pair<const char*, const char*> inp(i, i+sizeof(i)-1);
+      Static::Vector v;
+      Static::Vector w;
+      Static::Tee<Static::Vector, Static::Vector> t(v, w);
+      t.start(inp.first);
+      t.finish(inp.second);
+      BOOST_CHECK(v.begin() == inp.first);
+      BOOST_CHECK(w.end()   == inp.second);
+      {
+        const char *pe = inp.first+5;
+        Static::Resume<decltype(t)> r(t, inp.first, pe);
+        t.start(inp.first);
+        BOOST_CHECK(t.pending() == inp.first);
+      }
+      {
+        Static::Resume<decltype(t)> r(t, inp.first+5, inp.second);
+        t.finish(inp.second);
+      }
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "Hello World!");
+      BOOST_CHECK_EQUAL(string(w.begin(), w.end()), "Hello World!");
+      BOOST_CHECK(v.begin() != inp.first);
+    }
+
+    BOOST_AUTO_TEST_CASE( file )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/static_file";
+      fs::remove(filename);
+      fs::create_directory("tmp");
+      {
+        Buffer::File f("tmp", "static_file");
+        Buffer::Static::File g(f);
+        const char inp[] = "hello world";
+        const char *pe = inp + 5;
+        const char *qe = inp + sizeof(inp) - 1;
+        {
+          Buffer::Static::Resume<Buffer::Static::File> r(g, inp, pe);
+          g.start(inp);
+        }
+        {
+          Buffer::Static::Resume<Buffer::Static::File> r(g, pe, qe);
+          g.finish(qe);
+        }
+      }
+      ifstream f(filename, ofstream::in | ofstream::binary);
+      array<char, 32> b = {{0}};
+      f.read(b.data(), b.size()-1);
+      BOOST_CHECK_EQUAL(b.data(), "hello world");
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
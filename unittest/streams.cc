@@ -0,0 +1,172 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+
+#include <buffer/buffer.h>
+#include <buffer/streams.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( streams )
+
+    BOOST_AUTO_TEST_CASE( pool )
+    {
+      using namespace Memory;
+      BOOST_CHECK_EQUAL(Slab_Pool::size_class(1), 0u);
+      BOOST_CHECK_EQUAL(Slab_Pool::size_class(64), 0u);
+      BOOST_CHECK_EQUAL(Slab_Pool::size_class(65), 1u);
+      Slab_Pool p(4096);
+      char *a = p.get(0);
+      char *b = p.get(0);
+      BOOST_CHECK_EQUAL(p.slabs(), 1u);
+      BOOST_CHECK_EQUAL(p.in_use(), 128u);
+      p.put(a, 0);
+      BOOST_CHECK(p.get(0) == a);
+      // larger than a quarter slab: not from a slab
+      char *c = p.get(Slab_Pool::size_class(2048));
+      BOOST_CHECK_EQUAL(p.slabs(), 1u);
+      p.put(c, Slab_Pool::size_class(2048));
+      p.put(a, 0);
+      p.put(b, 0);
+      BOOST_CHECK_EQUAL(p.in_use(), 0u);
+    }
+
+    BOOST_AUTO_TEST_CASE( pool_release )
+    {
+      using namespace Memory;
+      Slab_Pool p(4096);
+      vector<char*> v;
+      // 64 chunks per slab
+      for (unsigned i = 0; i < 3 * 64; ++i)
+        v.push_back(p.get(0));
+      BOOST_CHECK_EQUAL(p.slabs(), 3u);
+      for (auto x : v)
+        p.put(x, 0);
+      // one empty slab is kept
+      BOOST_CHECK_EQUAL(p.slabs(), 1u);
+      v.clear();
+      for (unsigned i = 0; i < 64; ++i)
+        v.push_back(p.get(0));
+      BOOST_CHECK_EQUAL(p.slabs(), 1u);
+      for (auto x : v)
+        p.put(x, 0);
+      BOOST_CHECK_EQUAL(p.in_use(), 0u);
+    }
+
+    BOOST_AUTO_TEST_CASE( current )
+    {
+      using namespace Memory;
+      Buffer::Streams s;
+      const char i[] = "foo";
+      BOOST_CHECK_EQUAL(s.id(), Buffer::Streams::npos);
+      BOOST_CHECK_THROW(s.start(i), std::logic_error);
+      BOOST_CHECK_THROW(s.pending(), std::logic_error);
+      s.clear();
+      size_t a = s.open();
+      s.set(a);
+      s.start(i);
+      s.close(a);
+      BOOST_CHECK_EQUAL(s.id(), Buffer::Streams::npos);
+      BOOST_CHECK_THROW(s.finish(i + 3), std::logic_error);
+    }
+
+    BOOST_AUTO_TEST_CASE( interleaved )
+    {
+      using namespace Memory;
+      Buffer::Streams s;
+      const unsigned n = 1000;
+      vector<size_t> ids;
+      for (unsigned i = 0; i < n; ++i)
+        ids.push_back(s.open());
+      BOOST_CHECK_EQUAL(s.size(), n);
+
+      // each stream receives "<i>-abc" in two blocks, the blocks
+      // of the streams are interleaved
+      vector<string> a, b;
+      for (unsigned i = 0; i < n; ++i) {
+        a.push_back(" " + to_string(i));
+        b.push_back("-abc ");
+      }
+      for (unsigned i = 0; i < n; ++i) {
+        s.set(ids[i]);
+        const char *p = a[i].data();
+        const char *pe = p + a[i].size();
+        Buffer::Resume r(s, p, pe);
+        s.start(p + 1);
+      }
+      BOOST_CHECK(s.pool().in_use() > 0);
+      vector<string> tokens;
+      for (unsigned i = 0; i < n; ++i) {
+        s.set(ids[n - 1 - i]);
+        const char *p = b[n - 1 - i].data();
+        const char *pe = p + b[n - 1 - i].size();
+        Buffer::Resume r(s, p, pe);
+        s.finish(p + 4);
+        tokens.emplace_back(s.begin(), s.end());
+      }
+      for (unsigned i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(tokens[i], to_string(n - 1 - i) + "-abc");
+
+      // a token in one block is referenced
+      s.set(ids[0]);
+      const char i[] = "foo";
+      s.start(i);
+      BOOST_CHECK(s.pending() == i);
+      s.finish(i + 3);
+      BOOST_CHECK(s.begin() == i);
+
+      for (auto id : ids)
+        s.close(id);
+      BOOST_CHECK_EQUAL(s.size(), 0u);
+      BOOST_CHECK_EQUAL(s.pool().in_use(), 0u);
+      BOOST_CHECK_THROW(s.set(ids[0]), std::logic_error);
+      // ids are reused
+      BOOST_CHECK(s.open() < n);
+    }
+
+    BOOST_AUTO_TEST_CASE( grow )
+    {
+      using namespace Memory;
+      Buffer::Streams s;
+      s.set(s.open());
+      string x(100, 'x');
+      string ref;
+      s.start(x.data());
+      for (unsigned i = 0; i < 100; ++i) {
+        const char *p = x.data();
+        const char *pe = p + x.size();
+        Buffer::Resume r(s, p, pe);
+        ref += x;
+      }
+      s.finish();
+      BOOST_CHECK_EQUAL(string(s.begin(), s.end()), ref);
+      s.clear();
+      BOOST_CHECK_EQUAL(s.pool().in_use(), 0u);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include <buffer/buffer.h>
+#include <buffer/batch.h>
+#include <buffer/trace.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE( buffer )
+
+  BOOST_AUTO_TEST_SUITE( trace )
+
+    BOOST_AUTO_TEST_CASE( varint )
+    {
+      using namespace Memory;
+      Trace t;
+      t.add(Trace::RESUME);
+      t.add(Trace::START, 127);
+      t.add(Trace::FINISH, 128);
+      t.add(Trace::PAUSE, 1u << 20);
+      BOOST_CHECK_EQUAL(t.size(), 2u + 2u + 3u + 4u);
+      vector<size_t> offs;
+      t.for_each([&offs](Trace::Op, size_t off) { offs.push_back(off); });
+      const vector<size_t> ref = { 0, 127, 128, 1u << 20 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(offs.begin(), offs.end(),
+          ref.begin(), ref.end());
+      BOOST_CHECK_EQUAL(t.tokens(), 1u);
+      BOOST_CHECK_EQUAL(t.blocks(), 1u);
+      BOOST_CHECK_EQUAL(t.max_offset(), 1u << 20);
+    }
+
+    BOOST_AUTO_TEST_CASE( record_replay )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/trace";
+      fs::create_directory("tmp");
+      Trace t;
+      Buffer::Vector v;
+      Buffer::Recorder r(t, &v);
+      // "foo ba" "r baz"
+      string x("foo ba"), y("r baz");
+      {
+        const char *p = x.data();
+        const char *pe = p + x.size();
+        Buffer::Resume res(r, p, pe);
+        r.start(p);
+        r.finish(p + 3);
+        BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "foo");
+        r.start(p + 4);
+      }
+      {
+        const char *p = y.data();
+        const char *pe = p + y.size();
+        Buffer::Resume res(r, p, pe);
+        r.finish(p + 1);
+        BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "bar");
+        r.start(p + 2);
+      }
+      r.finish();
+      BOOST_CHECK_EQUAL(string(v.begin(), v.end()), "baz");
+      BOOST_CHECK_EQUAL(t.tokens(), 3u);
+      BOOST_CHECK_EQUAL(t.blocks(), 2u);
+
+      t.save(filename);
+      Trace u;
+      u.load(filename);
+      BOOST_CHECK_EQUAL(u.size(), t.size());
+      BOOST_CHECK_EQUAL(u.events(), t.events());
+
+      vector<size_t> lens;
+      Buffer::Batch b([&lens](const Buffer::Batch &b) {
+          for (size_t i = 0; i < b.size(); ++i)
+            lens.push_back(b[i].second - b[i].first);
+        });
+      Replay rep(u);
+      BOOST_CHECK_EQUAL(rep.run(b), 3u);
+      b.flush();
+      const vector<size_t> ref = { 3, 3, 3 };
+      BOOST_CHECK_EQUAL_COLLECTIONS(lens.begin(), lens.end(),
+          ref.begin(), ref.end());
+    }
+
+    BOOST_AUTO_TEST_CASE( corrupt )
+    {
+      using namespace Memory;
+      const char filename[] = "tmp/trace_corrupt";
+      fs::create_directory("tmp");
+      const string magic("LBTRACE1");
+      // truncated varint, too long varint, unknown opcode
+      const vector<string> inputs = {
+        magic + char(Trace::START),
+        magic + char(Trace::START) + char(0x80),
+        magic + char(Trace::START) + string(10, char(0xff)) + char(1),
+        magic + char(Trace::START) + string(9, char(0x80)) + char(2),
+        magic + char(42) + char(0)
+      };
+      for (auto &x : inputs) {
+        {
+          ofstream f(filename, ios::out | ios::binary | ios::trunc);
+          f << x;
+        }
+        Trace t;
+        BOOST_CHECK_THROW(t.load(filename), std::runtime_error);
+        BOOST_CHECK_EQUAL(t.size(), 0u);
+      }
+      // the largest offset still fits
+      {
+        ofstream f(filename, ios::out | ios::binary | ios::trunc);
+        f << magic + char(Trace::START) + string(9, char(0xff)) + char(1);
+      }
+      Trace t;
+      t.load(filename);
+      BOOST_CHECK_EQUAL(t.events(), 1u);
+    }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
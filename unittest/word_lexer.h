@@ -0,0 +1,113 @@
+// Copyright 2014, Georg Sauthoff <mail@georg.so>
+
+/* {{{ GPLv3
+
+    This file is part of libbuffer.
+
+    libbuffer is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libbuffer is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libbuffer.  If not, see <http://www.gnu.org/licenses/>.
+
+}}} */
+#ifndef GMS_UNITTEST_WORD_LEXER_H
+#define GMS_UNITTEST_WORD_LEXER_H
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <buffer/buffer.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Test {
+
+  // splits the input at spaces
+  struct Word_Lexer {
+    Memory::Buffer::Vector &v;
+    bool in {false};
+    std::vector<std::string> words;
+    size_t zero_copy {0};
+
+    Word_Lexer(Memory::Buffer::Vector &v)
+      : v(v)
+    {
+    }
+    void emit(const char *p)
+    {
+      if (v.end() == p)
+        ++zero_copy;
+      words.emplace_back(v.begin(), v.end());
+      in = false;
+    }
+    void operator()(const char *p, const char *pe)
+    {
+      for (; p != pe; ++p) {
+        if (*p == ' ') {
+          if (in) {
+            v.finish(p);
+            emit(p);
+          }
+        } else if (!in) {
+          v.start(p);
+          in = true;
+        }
+      }
+    }
+    void eof()
+    {
+      if (in) {
+        v.finish();
+        emit(nullptr);
+      }
+    }
+  };
+
+  inline std::vector<std::string> split(const std::string &s)
+  {
+    std::vector<std::string> r;
+    size_t i = 0;
+    for (;;) {
+      i = s.find_first_not_of(' ', i);
+      if (i == std::string::npos)
+        break;
+      size_t j = s.find(' ', i);
+      r.push_back(s.substr(i, j == std::string::npos ? j : j - i));
+      i = j;
+    }
+    return r;
+  }
+
+  struct Input {
+    int fd {-1};
+    Input(const std::string &filename, const std::string &content)
+    {
+      boost::filesystem::create_directory("tmp");
+      {
+        std::ofstream f(filename, std::ofstream::out | std::ofstream::binary);
+        f << content;
+      }
+      fd = open(filename.c_str(), O_RDONLY);
+      BOOST_REQUIRE(fd != -1);
+    }
+    ~Input()
+    {
+      close(fd);
+    }
+  };
+
+}
+
+#endif